@@ -29,6 +29,12 @@
 #include "bt.h"
 #include "i2c.h"
 #include "eeprom.h"
+#include "engine.h"
+#include "ai.h"
+#include "variant.h"
+#include "movelog.h"
+#include "undo.h"
+#include "snapshot.h"
 
 
 /******************************************************************************
@@ -45,8 +51,48 @@
 #define GAME_TYPE_DUAL_S 2
 
 #define MAX_BT_UNITS 5
+
+/* Start message of the server, a race sends the seed after it in hex */
+#define RACE_START     "LETS START PLAYING"
+#define RACE_START_LEN 18
+/*
+ * Answer of the client repeating the seed and confirmation of the server.
+ * The client races only after the confirmation, the server only after
+ * sending it.
+ */
+#define RACE_ACK       "RACE"
+#define RACE_ACK_LEN   4
+#define RACE_GO        "RACE GO"
+#define RACE_GO_LEN    7
+#define RACE_WAIT_MS   2000
+#define RACE_SEED_LEN  9   // a space and eight hex digits
 #define RECV_BUF_LEN 40
 
+/*
+ * A depth 5 search nests 10 maxNode()/chanceNode() frames of 96 bytes. By
+ * -fstack-usage the deepest path with the process and leaf frames is 1404
+ * bytes on a 32 bit host build, about 1650 bytes with the context save
+ * and the larger register saves of the board. This is not a measurement
+ * on the board: build with HINT_STACK_REPORT = 1 to print the peak usage
+ * on the console.
+ */
+#define HINT_STACK_SIZE 2048
+#define HINT_PRIO       4     /* lowest priority, runs while the game sleeps */
+#define HINT_MAX_DEPTH  5
+#define HINT_BUDGET     50    /* ms until a hint is shown */
+
+#define VARIANT_AREA (4 * MAXCOL)   /* the variant boards fill the 4x4 area */
+
+#define SIZE_MENU_REPLAY 4   /* choice after the board sizes */
+
+#define MOVELOG_EEPROM_ADDR 0x100   /* after the scores, MOVELOG_MAX_BYTES */
+#define EEPROM_PAGE_SIZE    16      /* a write must not cross a page */
+
+#define SNAPSHOT_EEPROM_ADDR 0x40   /* one page, see snapshot.h */
+#define SNAPSHOT_IDLE_MS     1000   /* pause after a move before saving */
+
+#define UNDO_PRESS_MS 600   /* holding the center key this long takes back a move */
+
 #define SCREEN_WIDTH ((tU8)130)
 #define SCREEN_HEIGHT ((tU8)130)
 #define CHAR_WIDTH 8
@@ -79,11 +125,9 @@ typedef struct
  * Local prototypes
  ****************************************************************************/
 static void setupLevel(void);
-static void showGrid(tS32 tab[][4]);
-static tBool isOccupied(tS32 tab[][4], tS32 y, tS32 x);
-static tBool checkEnd(tS32 tab[][4]);
-static void startRound(tS32 tab[][4]);
-static void moveGrid(tS32 tab[][4], tS8 dir);
+static void showGrid(tBoard board, tU16 cells);
+static tBool checkEnd(const tGame *pGame);
+static tU16 moveGrid(tS8 dir);
 static void sleepLight(tU32 t);
 static void playLight(tU32 hz);
 static void playLED(void);
@@ -91,9 +135,33 @@ static void sleepMusic(tU32 t);
 static void playNote(tU32 hz, float dlugosc);
 static void playSong(void);
 static void playNote(tU32, float);
-static tBool checkWin(tS32 tab[][4]);
+static tBool checkWin(const tGame *pGame);
 static void saveScore(tU8 score[5]);
 
+// HINT
+static void initHintProc(void);
+static void hintProc(void* arg);
+static tBool hintCancelled(void);
+static tU32 hintClock(void);
+static void requestHint(void);
+static void cancelHint(void);
+static void showHint(void);
+
+static void playVariant(tU8 size);
+static void setupVariant(tU8 size);
+static void showVariant(const tVariantGame *pGame, tVariantMask cells);
+
+static void runGame(tU8 gameType);
+static void undoMove(void);
+static void saveSnapshot(tBool finished);
+
+static void saveMoveLog(void);
+static tBool loadMoveLog(void);
+static void dumpMoveLog(void);
+static void replayLastGame(void);
+static void replayShow(const tGame *pGame, tU16 changed);
+static void putNumber(tU32 value);
+
 // BLUETOOTH
 static void activateServer();
 static tBool checkIfClinetConnected(tU8 *pBtAddr);
@@ -102,6 +170,15 @@ static tBool connectToServer(tU8 *pBtAddr);
 static void convertToDigits(tU8 *pBuf, tU8 value);
 static tBool decodeFromDigits(tU8 *pBuf, tU8 *pValue);
 
+static void sendRaceStart(void);
+static void sendRaceAck(void);
+static tBool waitRaceLine(const tU8 *pPrefix, tU8 len);
+static void writeRaceSeed(tU8 *pBuf, tU32 seed);
+static tBool readRaceSeed(tU8 *pBuf, tU8 len, tU32 *pSeed);
+static void sendRaceMove(tU8 dir);
+static tBool receiveRace(void);
+static void showOpponent(void);
+
 
 /*****************************************************************************
  * Local variables
@@ -111,13 +188,74 @@ static tBool done = FALSE;
 static tBool connected;
 static tMenu menu;
 static tU8 btAddress[13];
-static tU8 score;
+static tGame game;
 static tU8 oppScore;
 static tBtRecord foundBtUnits[MAX_BT_UNITS];
 static tU8 gameType;
 static tU8 recvPos;
 static tU8 recvBuf[RECV_BUF_LEN];
 
+static tU8 hintStack[HINT_STACK_SIZE];
+static tU8 hintPid;
+static tBool hintCreated = FALSE;
+static tCntSem hintSem;
+static volatile tBoard hintBoard;
+static volatile tU32 hintRequest;   // number of the newest request
+static volatile tU32 hintSearching; // number of the request being searched
+static volatile tU32 hintDone;      // number of the request hintMove belongs to
+static volatile tU8 hintMove;
+static tAiTable hintTable;
+static tU32 hintShown;
+static tBool hintVisible = FALSE;
+#if defined(HINT_STACK_REPORT)
+static tU8 hintStackPeak;           // highest stack usage of the hint process in percent
+#endif
+
+static tVariantGame variantGame;
+
+static tUndoRing undoRing;
+static tU16 movesPlayed;
+
+static tBool raceMode = FALSE;   // both boards play from raceSeed
+static tU32 raceSeed;
+static tGame oppGame;           // the board of the other player, rebuilt from its moves
+
+static tMoveLog moveLog;
+static tBool moveLogActive;   // FALSE for resumed games, they have no seed
+static tU8 moveLogBuf[MOVELOG_MAX_BYTES];
+
+/*
+ * Text and colour of a tile by its exponent, 0 is an empty cell. Values
+ * above 8192 are shortened to keep the four character width the redraw
+ * of showGrid() allows for.
+ */
+static const tU8 * const tileGlyph[ENGINE_TILES] =
+{
+  (const tU8 *) "0",    (const tU8 *) "2",    (const tU8 *) "4",
+  (const tU8 *) "8",    (const tU8 *) "16",   (const tU8 *) "32",
+  (const tU8 *) "64",   (const tU8 *) "128",  (const tU8 *) "256",
+  (const tU8 *) "512",  (const tU8 *) "1024", (const tU8 *) "2048",
+  (const tU8 *) "4096", (const tU8 *) "8192", (const tU8 *) "16k",
+  (const tU8 *) "32k"
+};
+
+static const tU8 tileColor[ENGINE_TILES] =
+{
+  0x49, 0xff, 0xfd, 0xf4, 0xec, 0xe4, 0xe0, 0xfc,
+  0xf8, 0xdc, 0x1c, 0x1f, 0x93, 0xe3, 0xa3, 0x6f
+};
+
+/* Exponent as text, for the narrow cells of the variant boards */
+static const tU8 * const tileExponent[ENGINE_TILES] =
+{
+  (const tU8 *) "0",  (const tU8 *) "1",  (const tU8 *) "2",
+  (const tU8 *) "3",  (const tU8 *) "4",  (const tU8 *) "5",
+  (const tU8 *) "6",  (const tU8 *) "7",  (const tU8 *) "8",
+  (const tU8 *) "9",  (const tU8 *) "10", (const tU8 *) "11",
+  (const tU8 *) "12", (const tU8 *) "13", (const tU8 *) "14",
+  (const tU8 *) "15"
+};
+
 
 /*****************************************************************************
  * External variables
@@ -128,40 +266,122 @@ extern volatile tU32 ms;
 /*****************************************************************************
  *
  * Description:
- *    Implement 2048 game
+ *    Implement 2048 game. In a race both boards start from the seed
+ *    exchanged at connect time.
  *
  ****************************************************************************/
 void play2048(tU8 gameType)
+{
+  tU32 seed = ms;
+
+  if (raceMode == (tBool)TRUE) {
+    seed = raceSeed;
+    engineNewGame(&oppGame, seed);
+  }
+  engineNewGame(&game, seed);
+  moveLogStart(&moveLog, seed);
+  moveLogActive = TRUE;
+  runGame(gameType);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Continues the single player game saved by the last snapshot, e.g.
+ *    after a reset or a power loss. Reads one EEPROM page.
+ *
+ ****************************************************************************/
+
+void resumeGame(void)
+{
+  tU8 record[SNAPSHOT_BYTES];
+
+  eepromPageRead(SNAPSHOT_EEPROM_ADDR, record, SNAPSHOT_BYTES);
+  if (snapshotUnpack(&game, record) == (tBool)FALSE) {
+    lcdColor(0, 0xfd);
+    lcdGotoxy(8, 0);
+    lcdPuts((const tU8 *) "No saved game");
+    lcdColor(0, 0xe0);
+    osSleep(100);
+    return;
+  }
+  moveLogActive = FALSE;
+  runGame(GAME_TYPE_SINGLE);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays the game set up in game until it is won or lost. Single player
+ *    games are saved as a snapshot whenever the player pauses. A short
+ *    press of the center key asks for a hint, holding it for UNDO_PRESS_MS
+ *    takes back a move.
+ *
+ ****************************************************************************/
+
+static void runGame(tU8 gameType)
 {
   tU8 keypress;
+  tU16 changed;
   tBool end = TRUE;
-  score = 0;
+  tBool centerDown = FALSE;   // center key held since centerSince
+  tBool centerUsed = FALSE;   // the held center key has taken back a move
+  tU32 centerSince = 0;
+  tBool unsaved = FALSE;
+  tU32 lastMove = ms;
   oppScore = 0;
 
-  srand(ms);
+  initHintProc();
+  undoClear(&undoRing);
+  movesPlayed = 0;
   setupLevel();
-
-  tS32 grid[4][4] = { {0,0,0,0},
-                      {0,0,0,0},
-                      {0,0,0,0},
-                      {0,0,0,0}};
-  startRound(grid);
-  showGrid(grid);
+  showGrid(game.board, ENGINE_ALL_CELLS);
+  if (raceMode == (tBool)TRUE) {
+    showOpponent();
+  }
   playLED();
 
   do {
     keypress = checkKey();
+    //the repeats of a held center key are ignored, its release is polled
+    if ((keypress == (tU8)KEY_CENTER) && (centerDown == (tBool)FALSE) &&
+        (checkKey2() == (tU8)KEY_CENTER)) {
+      centerDown = TRUE;
+      centerUsed = FALSE;
+      centerSince = ms;
+    }
+    if (centerDown == (tBool)TRUE) {
+      if (checkKey2() != (tU8)KEY_CENTER) {
+        //a short press asks for a hint
+        centerDown = FALSE;
+        if (centerUsed == (tBool)FALSE) {
+          requestHint();
+        }
+      } else if ((centerUsed == (tBool)FALSE) && ((ms - centerSince) >= (tU32)UNDO_PRESS_MS)) {
+        //a long press takes back a move
+        centerUsed = TRUE;
+        if (gameType == (tU8)GAME_TYPE_SINGLE) {
+          cancelHint();
+          undoMove();
+          unsaved = TRUE;
+          lastMove = ms;
+        }
+      }
+    }
     if ((keypress != (tU8)KEY_NOTHING) && (keypress != (tU8)KEY_CENTER)) {
       if ((keypress == (tU8)KEY_UP) || (keypress == (tU8)KEY_RIGHT) ||
           (keypress == (tU8)KEY_DOWN) || (keypress == (tU8)KEY_LEFT)) {
 
-        moveGrid(grid, keypress);
-        startRound(grid);
-        setupLevel();
-        showGrid(grid);
+        cancelHint();
+        changed = moveGrid(keypress);
+        if (changed != (tU16)ENGINE_NO_MOVE) {
+          showGrid(game.board, changed);
+          unsaved = TRUE;
+          lastMove = ms;
+        }
       }
     
-      if (gameType != (tU8)GAME_TYPE_SINGLE) {
+      if ((gameType != (tU8)GAME_TYPE_SINGLE) && (raceMode == (tBool)FALSE)) {
         recvPos = 0;
         tU8 rxChar;
 
@@ -177,7 +397,7 @@ void play2048(tU8 gameType)
               if ((memcmp(recvBuf, "NO CARRIER", 10) != 0)) {
                 oppScore /= 16;
 
-                if (oppScore > score) {
+                if (oppScore > (tU8)game.score) {
                   setLED(LED_GREEN, FALSE);
                   setLED(LED_RED,   TRUE);
                 } else {
@@ -203,27 +423,56 @@ void play2048(tU8 gameType)
         //send score to bt
         tU8 buf[4];
         buf[0] = 'S';
-        convertToDigits(&buf[1], (tU8) score);
+        convertToDigits(&buf[1], (tU8) game.score);
         buf[3] = 0x0a;
         uart1SendChars((char *) buf, 4);
       }
     }
 
-    if (checkEnd(grid) || checkWin(grid)) {
+    if (checkEnd(&game) || checkWin(&game)) {
         end = FALSE;
         tU8 tmpScore[5];
-        tmpScore[0] = '0';
-        tmpScore[1] = score / (tU8)100 + (tU8)'0';
-        tmpScore[2] = (score / (tU8)10) + (tU8)'0';
-        tmpScore[3] = score % (tU8)10 + (tU8)'0';
+        tmpScore[0] = (game.score / (tU16)1000) % (tU16)10 + (tU8)'0';
+        tmpScore[1] = (game.score / (tU16)100) % (tU16)10 + (tU8)'0';
+        tmpScore[2] = (game.score / (tU16)10) % (tU16)10 + (tU8)'0';
+        tmpScore[3] = game.score % (tU16)10 + (tU8)'0';
         tmpScore[4] = '\0';
         saveScore(tmpScore);
+        if (moveLogActive == (tBool)TRUE) {
+          saveMoveLog();
+          dumpMoveLog();
+        }
+        if (gameType == (tU8)GAME_TYPE_SINGLE) {
+          saveSnapshot(TRUE);
+        }
+        unsaved = FALSE;
         setLED(LED_GREEN, FALSE);
         setLED(LED_RED,   FALSE);
     }
 
+    //follow the moves of the other player, the link is gone on FALSE
+    if ((raceMode == (tBool)TRUE) && (receiveRace() == (tBool)FALSE)) {
+      end = FALSE;
+    }
+
+    //a pause of the player is a good moment for the EEPROM write
+    if ((unsaved == (tBool)TRUE) && (gameType == (tU8)GAME_TYPE_SINGLE) &&
+        ((ms - lastMove) >= (tU32)SNAPSHOT_IDLE_MS)) {
+      saveSnapshot(FALSE);
+      unsaved = FALSE;
+    }
+
+    showHint();
+    if (keypress == (tU8)KEY_NOTHING) {
+      //let the hint process search between keypresses
+      osSleep(1);
+    }
+
   } while (end == (tBool)TRUE);
 
+  cancelHint();
+  raceMode = FALSE;
+
   playSong();
 }
 
@@ -274,243 +523,181 @@ void setupLevel()
 /*****************************************************************************
  *
  * Description:
- *    Display values of all cells in the game grid.
+ *    Display values of the selected cells in the game grid. The text and
+ *    colour of a cell are looked up by the exponent of its tile. The value
+ *    of a cell overhangs into its right neighbour, so that neighbour is
+ *    repainted too and the value of the left neighbour of every repainted
+ *    cell is written again.
+ *
+ * Params:
+ *    [in] board - The packed board.
+ *    [in] cells - Mask of the cells to repaint, bit i*4+k for cell (i, k).
  *
  ****************************************************************************/
 
-void showGrid(tS32 tab[][4])
+void showGrid(tBoard board, tU16 cells)
 {
+  tU16 text;
   tS32 i;
   tS32 k;
+
+  cells |= (tU16)((cells << 1) & 0xeeee);
+  text = cells | (tU16)((cells >> 1) & 0x7777);
   for (i = 0; i < 4; ++i) {
     for (k = 0; k < 4; ++k) {
-      lcdGotoxy((k*MAXCOL)+20,(i*MAXROW)+20);
-      switch (tab[i][k]) 
-      {
-      case 0:
-        lcdPuts((const tU8 *) "0");
-          break;
-      case 2:
-          lcdPuts((const tU8 *) "2");
-          break;
-      case 4:
-          lcdPuts((const tU8 *) "4");
-          break;
-      case 8:
-          lcdPuts((const tU8 *) "8");
-          break;
-      case 16:
-          lcdPuts((const tU8 *) "16");
-          break;
-      case 32:
-          lcdPuts((const tU8 *) "32");
-          break;
-      case 64:
-          lcdPuts((const tU8 *) "64");
-          break;
-      case 128:
-          lcdPuts((const tU8 *) "128");
-          break;
-      case 256:
-          lcdPuts((const tU8 *) "256");
-          break;
-      case 512:
-          lcdPuts((const tU8 *) "512");
-          break;
-      case 1024:
-          lcdPuts((const tU8 *) "1024");
-          break;
-      case 2048:
-          lcdPuts((const tU8 *) "2048");
-          break;
-      default:
-          break;
+      if ((cells & (1 << ((i * 4) + k))) != 0) {
+        lcdRect((k*MAXCOL)+2, (i*MAXROW)+16, MAXCOL, MAXROW, 196);
+      }
+    }
+  }
+  for (i = 0; i < 4; ++i) {
+    for (k = 0; k < 4; ++k) {
+      tU8 tile = engineGetCell(board, i, k);
+      if ((text & (1 << ((i * 4) + k))) == 0) {
+        continue;
       }
+      lcdGotoxy((k*MAXCOL)+20,(i*MAXROW)+20);
+      lcdColor(0, tileColor[tile]);
+      lcdPuts(tileGlyph[tile]);
     }
   }
+  lcdColor(0, 0xe0);
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Check whether cell is occupied (cell value greater than zero).
+ *    Check if game ended (no empty cells and no cells that can be
+ *    connected). Uses the board summary kept up to date by every move.
  * 
- * Return: TRUE if cell is occupied
- *         FALSE if cell is empty
+ * Return: TRUE if no move is possible
+ *         FALSE if there is an empty cell or two cells can be connected
  *
  ****************************************************************************/
 
-tBool isOccupied(tS32 tab[4][4], tS32 y, tS32 x)
+tBool checkEnd(const tGame *pGame)
 {
-  return (tab[y][x]);
+  return engineGameOver(pGame);
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Check if game ended (no empty cells).
+ *    Check if game ended (a cell has a value of 2048).
  * 
- * Return: TRUE if no empty cells
- *         FALSE if there are empty cells
+ * Return: TRUE if a cell has a value of 2048
+ *         FALSE if no cell has a value of 2048
  *
  ****************************************************************************/
 
-tBool checkEnd(tS32 tab[][4])
-{
-  tS32 i, k;
-  for (i = 0; i < 4; ++i) {
-    for (k = 0; k < 4; ++k) {
-      if (tab[i][k] == 0) {
-        return FALSE;
-      }
-    }
-  }
-  return TRUE;
+tBool checkWin(const tGame *pGame)
+{ 
+  return engineGameWon(pGame);
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Check if game ended (a cell has a value of 2048).
- * 
- * Return: TRUE if a cell has a value of 2048
- *         FALSE if no cell has a value of 2048
+ *    Moves the cells in the grid according to the received input.
+ *    Every cell slides as far as possible, two cells of the same value
+ *    are connected when they collide, each cell at most once per move.
+ *    Increases the score by one each time two cells are connected.
+ *    If anything moved a random empty cell is filled with a 2 (or a 4
+ *    with a chance of 10 %), drawn from the game's own generator.
+ *    Every move that changed the grid is added to the move log and the
+ *    state before it to the undo ring, and in a race sent to the other
+ *    board.
+ *
+ * Return: mask of the changed cells
+ *         ENGINE_NO_MOVE if the grid is unchanged
  *
  ****************************************************************************/
 
-tBool checkWin(tS32 tab[][4])
-{ 
-  tS32 i,k;
-  for (i = 0; i < 4; ++i) {
-    for (k = 0; k < 4; ++k) {
-      if (tab[i][k] == 2048) {
-          return TRUE;
-      }
+tU16 moveGrid(tS8 direction)
+{
+  tU16 changed = ENGINE_NO_MOVE;
+  tGame before = game;
+  tU8 dir;
+
+  switch (direction) {
+    case KEY_UP:
+      dir = ENGINE_UP;
+      break;
+
+    case KEY_DOWN:
+      dir = ENGINE_DOWN;
+      break;
+
+    case KEY_LEFT:
+      dir = ENGINE_LEFT;
+      break;
+
+    case KEY_RIGHT:
+      dir = ENGINE_RIGHT;
+      break;
+      
+      default:
+          return changed;
+  }
+
+  changed = engineStep(&game, dir);
+  if (changed != (tU16)ENGINE_NO_MOVE) {
+    undoPush(&undoRing, &before);
+    movesPlayed++;
+    if (raceMode == (tBool)TRUE) {
+      sendRaceMove(dir);
+    }
+
+    //a full log keeps the start of the game and the board it ends with
+    if ((moveLogActive == (tBool)TRUE) &&
+        (moveLogAdd(&moveLog, dir) == (tBool)TRUE)) {
+      moveLogFinish(&moveLog, game.board);
     }
   }
-  return FALSE;
+  return changed;
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Selects 2 random empty cells (1 if only one left) and sets their values
- *    to 2.
+ *    Takes back the last move from the undo ring and the move log. Only
+ *    the cells that differ from the undone board are redrawn.
  *
  ****************************************************************************/
 
-void startRound(tS32 tab[][4])
+static void undoMove(void)
 {
-  tBool set;
-  tS32 i;
-  for (i = 0; i < 2; ++i) {
-    set = FALSE;
-    while (!set) {
-      if (checkEnd(tab) == (tBool)TRUE) {
-        set = TRUE;
-      }
-      tS32 y = rand() % 4;
-      tS32 x = rand() % 4;
-      if (!isOccupied(tab, y, x)) {
-          tab[y][x] = 2;
-          set = TRUE;
-      }
-    }
+  tBoard after = game.board;
+
+  if (undoPop(&undoRing, &game) == FALSE) {
+    return;
   }
+  movesPlayed--;
+  if (moveLogActive == (tBool)TRUE) {
+    moveLogTruncate(&moveLog, movesPlayed, game.board);
+  }
+  showGrid(game.board, engineChangedCells(after, game.board));
 }
 
 /*****************************************************************************
  *
  * Description:
- *    Moves the cells in the grid according to the received input.
- *    Connects two cells of the same value if they collide.
- *    Increases the score by one each time two cells are connected.
+ *    Writes the snapshot of the game to its EEPROM page, or an all zero
+ *    page once the game is finished so it cannot be resumed.
  *
  ****************************************************************************/
 
-void moveGrid(tS32 tab[4][4], tS8 direction)
+static void saveSnapshot(tBool finished)
 {
-  tS32 i,k;
-  switch (direction) {
-    case KEY_UP:
-      for (i = 3; i > 0; --i) {
-        for (k = 3; k >= 0; --k) {
-          if (isOccupied(tab, i, k) != (tBool)0) {
-            if (isOccupied(tab, i - 1, k) != (tBool)0) {
-              if (tab[i][k] == tab[i - 1][k]) {
-                score += (tU8)1;
-                tab[i][k] = 0;
-                tab[i - 1][k] *= 2;
-              }
-              continue;
-            }
-            tab[i - 1][k] = tab[i][k];
-            tab[i][k] = 0;
-          }
-        }
-      }
-      break;
-
-    case KEY_DOWN:
-      for ( i = 0; i < 4; ++i) {
-        for (k = 0; k < 4; ++k) {
-          if (isOccupied(tab, i, k) != (tBool)0) {
-            if (isOccupied(tab, i + 1, k) != (tBool)0) {
-              if (tab[i][k] == tab[i + 1][k]) {
-                score += (tU8)1;
-                tab[i][k] = 0;
-                tab[i + 1][k] *= 2;
-              }
-              continue; 
-            }
-            tab[i + 1][k] = tab[i][k];
-            tab[i][k] = 0;
-          }
-        }
-      }
-      break;
-
-    case KEY_LEFT:
-      for (i = 0; i < 4; ++i) {
-        for (k = 3; k > 0; k--) {
-          if (isOccupied(tab, i, k) != (tBool)0) {
-            if (isOccupied(tab, i, k - 1) != (tBool)0) {
-              if (tab[i][k] == tab[i][k - 1]) {
-                score += (tU8)1;
-                tab[i][k] = 0;
-                tab[i][k - 1] *= 2;
-              }
-              continue;
-            }
-            tab[i][k - 1] = tab[i][k];
-            tab[i][k] = 0;
-          }
-        }
-      }
-      break;
+  tU8 record[SNAPSHOT_BYTES];
 
-    case KEY_RIGHT:
-      for (i = 0; i < 4; ++i) {
-        for (k = 0; k < 3; ++k) {
-          if (isOccupied(tab, i, k) != (tBool)0) {
-            if (isOccupied(tab, i, k + 1) != (tBool)0) {
-              if (tab[i][k] == tab[i][k + 1]) {
-                score += (tU8)1;
-                tab[i][k] = 0;
-                tab[i][k + 1] *= 2;
-              }
-              continue;
-            }
-            tab[i][k + 1] = tab[i][k];
-            tab[i][k] = 0;
-          }
-        }
-      }
-      break;
-      
-      default:
-          break;
+  if (finished == (tBool)TRUE) {
+    memset(record, 0, SNAPSHOT_BYTES);
+  } else {
+    snapshotPack(&game, record);
   }
+  eepromWrite(SNAPSHOT_EEPROM_ADDR, record, SNAPSHOT_BYTES);
+  eepromPoll();
 }
 
 /*****************************************************************************
@@ -676,91 +863,843 @@ void playSong(void)
 
 /******************************************************************************
  ******************************************************************************
- * BLUETOOTH HANDLING PARTS
+ * HINT HANDLING PARTS
  ******************************************************************************
  *****************************************************************************/
-#define RECV_BUF_LEN 40
-static tU8 recvPos;
-static tU8 recvBuf[RECV_BUF_LEN];
 
+/*****************************************************************************
+ *
+ * Description:
+ *    Creates the hint process on the first game. The process then waits
+ *    on a semaphore for requests for the rest of the time.
+ *
+ ****************************************************************************/
 
-/******************************************************************************
- * Activate server functionality
- *****************************************************************************/
-static void
-activateServer()
+static void initHintProc(void)
 {
-  osSleep(100);
-  uart1SendString((const tU8 *) "+++");
-  osSleep(100);
-  uart1SendString((const tU8 *) "AT+BTCAN\r");
-  osSleep(50);
-  uart1SendString((const tU8 *) "AT+BTSRV=20,\"2048Server\"\r");
-  recvPos = 0;
+  tU8 error;
+
+  if (hintCreated == (tBool)FALSE) {
+    aiTableClear(&hintTable);
+    osSemInit(&hintSem, 0);
+    osCreateProcess(hintProc, hintStack, HINT_STACK_SIZE, &hintPid, HINT_PRIO, NULL, &error);
+    osStartProcess(hintPid, &error);
+    hintCreated = TRUE;
+  }
+  hintShown = hintRequest;
+  hintVisible = FALSE;
 }
 
-/******************************************************************************
- * Return: TRUE if connection established
- *         FALSE if no connection established
- *****************************************************************************/
-static tBool
-checkIfClinetConnected(tU8 *pBtAddr)
-{
-  tU8 rxChar;
-
-  //check if any character has been received from BT
-  if (uart1GetChar(&rxChar) == (tU8)TRUE)
-  {
-    printf("%c", rxChar);
-
-    if (rxChar == (tU8)0x0a)
-    {
-      if (recvPos > (tU8)0){
-        recvBuf[recvPos-(tU8)1] = '\0';
-      }
-
-      //evaluate received bytes
-      if ((memcmp(recvBuf, "CONNECT ", 8) == 0) && (recvPos == (tU8)21))
-      {
-        for (recvPos=(tU8)0; recvPos<(tU8)12; recvPos++)
-        {
-          *pBtAddr = recvBuf[recvPos + (tU8)8];
-          pBtAddr++;
-        }
-        *pBtAddr = '\0';
+/*****************************************************************************
+ *
+ * Description:
+ *    The hint process. Runs an expectimax search for every request at the
+ *    lowest priority, so it only gets the cycles the game loop leaves
+ *    while it sleeps. The search deepens until HINT_BUDGET ms have passed.
+ *    It is dropped as soon as a newer request or a cancel arrives.
+ *
+ * Params:
+ *    [in] arg - This parameter is not used.
+ *
+ ****************************************************************************/
 
-        return TRUE;
-      }
-      recvPos = 0;
-    }
-    else if (recvPos < (tU8)RECV_BUF_LEN) {
-      recvBuf[recvPos] = rxChar;
-      recvPos++;
+static void hintProc(void* arg)
+{
+  tAiSearch search;
+  tBoard board;
+  tU8 move;
+  tU8 error;
+
+  for (;;) {
+    osSemTake(&hintSem, 0, &error);
+
+    hintSearching = hintRequest;
+    board = hintBoard;
+    search.depth = HINT_MAX_DEPTH;
+    search.pAbort = hintCancelled;
+    search.pClock = hintClock;
+    search.budget = HINT_BUDGET;
+    search.pTable = &hintTable;
+    move = aiIterativeMove(&search, board);
+
+    if ((search.aborted == (tBool)FALSE) && (hintCancelled() == (tBool)FALSE)) {
+      hintMove = move;
+      hintDone = hintSearching;
     }
   }
-
-  //no connection established
-  return FALSE;
 }
 
+/*****************************************************************************
+ *
+ * Description:
+ *    Abort callback of the search.
+ *
+ * Return: TRUE if the request being searched is stale
+ *
+ ****************************************************************************/
 
-/******************************************************************************
- * Return: TRUE if connection succeeded
- *         FALSE if connection failed
- *****************************************************************************/
-static tBool
-connectToServer(tU8 *pBtAddr)
+static tBool hintCancelled(void)
 {
-  volatile tU32 timeStamp;
-  tU8 connected;
-  tU8 rxChar;
-  tU32 cnt = 0;
+  return (hintSearching != hintRequest);
+}
 
-  osSleep(100);
-  uart1SendString((const tU8 *) "+++");
-  osSleep(100);
-  uart1SendString((const tU8 *) "AT+BTCAN\r");
-  osSleep(50);
+/*****************************************************************************
+ *
+ * Description:
+ *    Clock callback of the search.
+ *
+ * Return: milliseconds since startup
+ *
+ ****************************************************************************/
+
+static tU32 hintClock(void)
+{
+  return ms;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Asks the hint process for the best move on the current board.
+ *
+ ****************************************************************************/
+
+static void requestHint(void)
+{
+  tU8 error;
+
+  hintBoard = game.board;
+  hintRequest++;
+  osSemGive(&hintSem, &error);
+
+  lcdColor(0, 0x1c);
+  lcdGotoxy(96, 0);
+  lcdPuts((const tU8 *) "....");
+  lcdColor(0, 0xe0);
+  hintVisible = TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Makes a running search stale and removes a displayed hint.
+ *
+ ****************************************************************************/
+
+static void cancelHint(void)
+{
+  hintRequest++;
+  hintShown = hintRequest;
+
+  if (hintVisible == (tBool)TRUE) {
+    lcdColor(0, 0xe0);
+    lcdGotoxy(96, 0);
+    lcdPuts((const tU8 *) "    ");
+    hintVisible = FALSE;
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Displays the result of the newest request once it is available. With
+ *    HINT_STACK_REPORT a new peak of the hint stack usage is printed on
+ *    the console.
+ *
+ ****************************************************************************/
+
+static void showHint(void)
+{
+  tU32 request = hintRequest;
+#if defined(HINT_STACK_REPORT)
+  tU8 usage;
+#endif
+
+  if ((hintShown == request) || (hintDone != request)) {
+    return;
+  }
+  hintShown = request;
+
+#if defined(HINT_STACK_REPORT)
+  usage = osStackUsage(hintPid);
+  if (usage > hintStackPeak) {
+    hintStackPeak = usage;
+    printf("\nhint stack %d%% of %d bytes\n", usage, HINT_STACK_SIZE);
+  }
+#endif
+
+  lcdColor(0, 0x1c);
+  lcdGotoxy(96, 0);
+  switch (hintMove) {
+    case ENGINE_UP:    lcdPuts((const tU8 *) "  UP"); break;
+    case ENGINE_RIGHT: lcdPuts((const tU8 *) "RGHT"); break;
+    case ENGINE_DOWN:  lcdPuts((const tU8 *) "DOWN"); break;
+    case ENGINE_LEFT:  lcdPuts((const tU8 *) "LEFT"); break;
+    default:           lcdPuts((const tU8 *) "NONE"); break;
+  }
+  lcdColor(0, 0xe0);
+  hintVisible = TRUE;
+}
+
+/******************************************************************************
+ ******************************************************************************
+ * BOARD SIZE VARIANT PARTS
+ ******************************************************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Asks for the board size of a single player game. 4x4 is the regular
+ *    game, the other sizes are played by the variant engine. The last
+ *    choice replays the last 4x4 game instead.
+ *
+ ****************************************************************************/
+
+void startSingleGame(void)
+{
+  tU8 choice;
+  tU8 size;
+
+  menu.xPos = 10;
+  menu.yPos = 20;
+  menu.xLen = 6+(13*8);
+  menu.yLen = 7*14;
+  menu.noOfChoices = 5;
+  menu.initialChoice = 1;
+  menu.pHeaderText = (const tU8 *) "Board size";
+  menu.headerTextXpos = 25;
+  menu.pChoice[0] = (const tU8 *) "3 x 3";
+  menu.pChoice[1] = (const tU8 *) "4 x 4";
+  menu.pChoice[2] = (const tU8 *) "5 x 5";
+  menu.pChoice[3] = (const tU8 *) "6 x 6";
+  menu.pChoice[4] = (const tU8 *) "Replay last";
+  menu.bgColor       = 0;
+  menu.borderColor   = 0x6d;
+  menu.headerColor   = 0;
+  menu.choicesColor  = 0xfd;
+  menu.selectedColor = 0xe0;
+
+  choice = drawMenu(menu);
+  if (choice == (tU8)SIZE_MENU_REPLAY) {
+    replayLastGame();
+    return;
+  }
+
+  size = (tU8)(choice + VARIANT_MIN_SIZE);
+  if (variantSupported(size) == (tBool)TRUE) {
+    playVariant(size);
+  } else {
+    play2048(GAME_TYPE_SINGLE);
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Single player game on a board of size x size cells. No hints, no
+ *    bluetooth and no high score, the scores of the sizes do not compare.
+ *
+ ****************************************************************************/
+
+static void playVariant(tU8 size)
+{
+  tU8 keypress;
+  tVariantMask changed;
+
+  variantNewGame(&variantGame, size, ms);
+  setupVariant(size);
+  showVariant(&variantGame, ~(tVariantMask)0);
+  playLED();
+
+  while ((variantGameOver(&variantGame) == FALSE) &&
+         (variantGameWon(&variantGame) == FALSE)) {
+    keypress = checkKey();
+    changed = VARIANT_NO_MOVE;
+    switch (keypress) {
+      case KEY_UP:    changed = variantStep(&variantGame, ENGINE_UP);    break;
+      case KEY_RIGHT: changed = variantStep(&variantGame, ENGINE_RIGHT); break;
+      case KEY_DOWN:  changed = variantStep(&variantGame, ENGINE_DOWN);  break;
+      case KEY_LEFT:  changed = variantStep(&variantGame, ENGINE_LEFT);  break;
+      default:
+        osSleep(1);
+        break;
+    }
+    if (changed != (tVariantMask)VARIANT_NO_MOVE) {
+      showVariant(&variantGame, changed);
+    }
+  }
+
+  setLED(LED_GREEN, FALSE);
+  setLED(LED_RED,   FALSE);
+  playSong();
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Draws the screen of a variant game, see setupLevel().
+ *
+ ****************************************************************************/
+
+static void setupVariant(tU8 size)
+{
+  tU8 cell = (tU8)(VARIANT_AREA / size);
+  tU8 title[9];
+
+  //clear screen
+  lcdColor(0, 0xe0);
+  lcdClrscr();
+
+  //narrow cells show the exponent of the tiles
+  if (cell >= (tU8)(4 * CHAR_WIDTH)) {
+    memcpy(title, "2048 0x0", 9);
+  } else {
+    memcpy(title, "2^n  0x0", 9);
+  }
+  title[5] = (tU8)('0' + size);
+  title[7] = (tU8)('0' + size);
+  lcdGotoxy(33, 0);
+  lcdPuts(title);
+
+  //draw game board rectangle
+  lcdRect(0, 14, (size * cell) + 4, (size * cell) + 4, 3);
+  lcdRect(2, 16, size * cell, size * cell, 1);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Repaints the selected cells of a variant board. The labels fit their
+ *    cell, so unlike showGrid() no neighbour is repainted.
+ *
+ * Params:
+ *    [in] pGame - The variant game.
+ *    [in] cells - Mask of the cells to repaint, bit y*size+x for cell (y, x).
+ *
+ ****************************************************************************/
+
+static void showVariant(const tVariantGame *pGame, tVariantMask cells)
+{
+  tU8 size = pGame->size;
+  tU8 cell = (tU8)(VARIANT_AREA / size);
+  const tU8 * const *pGlyph = tileGlyph;
+  tU8 tile;
+  tU8 y;
+  tU8 x;
+
+  //narrow cells show the exponent of the tiles
+  if (cell < (tU8)(4 * CHAR_WIDTH)) {
+    pGlyph = tileExponent;
+  }
+  for (y = 0; y < size; ++y) {
+    for (x = 0; x < size; ++x) {
+      if ((cells & ((tVariantMask)1 << ((y * size) + x))) == 0) {
+        continue;
+      }
+      lcdRect((x * cell) + 2, (y * cell) + 16, cell, cell, 196);
+      tile = variantGetCell(pGame, y, x);
+      lcdGotoxy((x * cell) + 3, (y * cell) + 16 + ((cell - 14) / 2));
+      lcdColor(0, tileColor[tile]);
+      lcdPuts(pGlyph[tile]);
+    }
+  }
+  lcdColor(0, 0xe0);
+}
+
+/******************************************************************************
+ ******************************************************************************
+ * MOVE LOG PARTS
+ ******************************************************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes the move log of the game to the EEPROM, a page at a time.
+ *
+ ****************************************************************************/
+
+static void saveMoveLog(void)
+{
+  tU16 len = moveLogPack(&moveLog, moveLogBuf);
+  tU16 i;
+
+  for (i = 0; i < len; i += EEPROM_PAGE_SIZE) {
+    eepromWrite(MOVELOG_EEPROM_ADDR + i, &moveLogBuf[i],
+                ((len - i) < (tU16)EEPROM_PAGE_SIZE) ? (len - i) : EEPROM_PAGE_SIZE);
+    eepromPoll();
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reads the move log saved by saveMoveLog().
+ *
+ * Return: FALSE if no game was saved yet
+ *
+ ****************************************************************************/
+
+static tBool loadMoveLog(void)
+{
+  tU16 i;
+
+  for (i = 0; i < (tU16)MOVELOG_MAX_BYTES; i += EEPROM_PAGE_SIZE) {
+    eepromPageRead(MOVELOG_EEPROM_ADDR + i, &moveLogBuf[i],
+                   ((MOVELOG_MAX_BYTES - i) < EEPROM_PAGE_SIZE) ?
+                   (MOVELOG_MAX_BYTES - i) : EEPROM_PAGE_SIZE);
+  }
+  return moveLogUnpack(&moveLog, moveLogBuf, MOVELOG_MAX_BYTES);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Sends the move log over the console UART as one line of hex digits,
+ *    "MOVELOG " first, for host/replay.
+ *
+ ****************************************************************************/
+
+static void dumpMoveLog(void)
+{
+  static const tU8 toHex[16] = {'0', '1', '2', '3', '4', '5', '6', '7',
+                                '8', '9', 'a', 'b', 'c', 'd', 'e', 'f'};
+  static tU8 line[8 + (2 * MOVELOG_MAX_BYTES) + 2];
+  tU16 len = moveLogPack(&moveLog, moveLogBuf);
+  tU16 i;
+
+  memcpy(line, "MOVELOG ", 8);
+  for (i = 0; i < len; ++i) {
+    line[8 + (2 * i)] = toHex[moveLogBuf[i] >> 4];
+    line[9 + (2 * i)] = toHex[moveLogBuf[i] & 0x0f];
+  }
+  line[8 + (2 * len)] = '\n';
+  line[9 + (2 * len)] = '\0';
+  printf("%s", (char *)line);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Replays the last saved game, drawn move by move, at full speed
+ *    without drawing, or only sent over the UART.
+ *
+ ****************************************************************************/
+
+static void replayLastGame(void)
+{
+  tU32 start;
+  tBool same;
+  tU8 mode;
+
+  if (loadMoveLog() == (tBool)FALSE) {
+    lcdColor(0, 0xfd);
+    lcdGotoxy(8, 0);
+    lcdPuts((const tU8 *) "No game saved");
+    lcdColor(0, 0xe0);
+    osSleep(100);
+    return;
+  }
+
+  menu.xPos = 10;
+  menu.yPos = 20;
+  menu.xLen = 6+(13*8);
+  menu.yLen = 5*14;
+  menu.noOfChoices = 3;
+  menu.initialChoice = 0;
+  menu.pHeaderText = (const tU8 *) "Replay";
+  menu.headerTextXpos = 40;
+  menu.pChoice[0] = (const tU8 *) "Show moves";
+  menu.pChoice[1] = (const tU8 *) "Full speed";
+  menu.pChoice[2] = (const tU8 *) "Dump to UART";
+  menu.bgColor       = 0;
+  menu.borderColor   = 0x6d;
+  menu.headerColor   = 0;
+  menu.choicesColor  = 0xfd;
+  menu.selectedColor = 0xe0;
+
+  mode = drawMenu(menu);
+  if (mode == (tU8)2) {
+    dumpMoveLog();
+    return;
+  }
+
+  if (mode == (tU8)0) {
+    setupLevel();
+  }
+  start = ms;
+  same = moveLogReplay(&moveLog, &game, (mode == (tU8)0) ? replayShow : NULL);
+  start = ms - start;
+
+  //result below the board, or on a cleared screen
+  if (mode != (tU8)0) {
+    lcdColor(0, 0xe0);
+    lcdClrscr();
+  }
+  lcdColor(0, 0xfd);
+  lcdGotoxy(0, 0);
+  putNumber(moveLog.count);
+  lcdPuts((const tU8 *) " mv ");
+  putNumber(start);
+  lcdPuts((const tU8 *) " ms ");
+  lcdPuts((same == (tBool)TRUE) ? (const tU8 *) "OK" : (const tU8 *) "DIFF");
+  lcdColor(0, 0xe0);
+
+  while (checkKey() != KEY_CENTER) {
+    osSleep(1);
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Draws a replayed move, see moveLogReplay().
+ *
+ ****************************************************************************/
+
+static void replayShow(const tGame *pGame, tU16 changed)
+{
+  showGrid(pGame->board, changed);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes a number in decimal at the cursor.
+ *
+ ****************************************************************************/
+
+static void putNumber(tU32 value)
+{
+  tU8 digits[11];
+  tU8 n = sizeof(digits) - 1;
+
+  digits[n] = '\0';
+  do {
+    digits[--n] = (tU8)('0' + (value % 10));
+    value /= 10;
+  } while (value != 0);
+  lcdPuts(&digits[n]);
+}
+
+/******************************************************************************
+ ******************************************************************************
+ * RACE PARTS
+ ******************************************************************************
+ *****************************************************************************/
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Accepts a client and offers a race: picks the seed of both boards
+ *    and sends it after the start message. When the client repeats the
+ *    seed the race is confirmed, otherwise the scores are exchanged.
+ *
+ ****************************************************************************/
+
+static void sendRaceStart(void)
+{
+  tU8 buf[1 + RACE_START_LEN + RACE_SEED_LEN + 2];
+  tU32 seed;
+
+  raceSeed = ms;
+  raceMode = FALSE;
+
+  buf[0] = '\n';
+  memcpy(&buf[1], RACE_START, RACE_START_LEN);
+  writeRaceSeed(&buf[1 + RACE_START_LEN], raceSeed);
+  //the receiver drops the character before the line end
+  buf[1 + RACE_START_LEN + RACE_SEED_LEN] = '\r';
+  buf[2 + RACE_START_LEN + RACE_SEED_LEN] = '\n';
+  uart1SendChars((char *) buf, sizeof(buf));
+
+  //a client without races never answers
+  if ((waitRaceLine((const tU8 *) RACE_ACK, RACE_ACK_LEN) == (tBool)TRUE) &&
+      (readRaceSeed(&recvBuf[RACE_ACK_LEN], recvPos - RACE_ACK_LEN, &seed) == (tBool)TRUE) &&
+      (seed == raceSeed)) {
+    uart1SendString((const tU8 *) RACE_GO "\r\n");
+    raceMode = TRUE;
+  }
+  recvPos = 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Answers the start message of the server with the seed read from it.
+ *
+ ****************************************************************************/
+
+static void sendRaceAck(void)
+{
+  tU8 buf[RACE_ACK_LEN + RACE_SEED_LEN + 2];
+
+  memcpy(buf, RACE_ACK, RACE_ACK_LEN);
+  writeRaceSeed(&buf[RACE_ACK_LEN], raceSeed);
+  buf[RACE_ACK_LEN + RACE_SEED_LEN]     = '\r';
+  buf[RACE_ACK_LEN + RACE_SEED_LEN + 1] = '\n';
+  uart1SendChars((char *) buf, sizeof(buf));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Waits for a line of the other board starting with the given prefix,
+ *    other lines are skipped.
+ *
+ * Params:
+ *    [in] pPrefix - Start of the expected line.
+ *    [in] len     - Length of the prefix.
+ *
+ * Return: TRUE if the line arrived within RACE_WAIT_MS, it is then left
+ *         in recvBuf with its length in recvPos
+ *
+ ****************************************************************************/
+
+static tBool waitRaceLine(const tU8 *pPrefix, tU8 len)
+{
+  tU32 timeStamp = ms;
+  tU8 rxChar;
+
+  recvPos = 0;
+  while ((ms - timeStamp) < (tU32)RACE_WAIT_MS) {
+    if (uart1GetChar(&rxChar) == (tU8)FALSE) {
+      osSleep(1);
+      continue;
+    }
+
+    if (rxChar != (tU8)0x0a) {
+      if (recvPos < (tU8)RECV_BUF_LEN) {
+        recvBuf[recvPos] = rxChar;
+        recvPos++;
+      }
+      continue;
+    }
+
+    if ((recvPos >= len) && (memcmp(recvBuf, pPrefix, len) == 0)) {
+      return TRUE;
+    }
+    recvPos = 0;
+  }
+  return FALSE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes a seed as a space and eight hex digits, highest byte first.
+ *
+ ****************************************************************************/
+
+static void writeRaceSeed(tU8 *pBuf, tU32 seed)
+{
+  tU8 i;
+
+  pBuf[0] = ' ';
+  for (i = 0; i < (tU8)4; ++i) {
+    convertToDigits(&pBuf[1 + (i * 2)], (tU8)(seed >> (24 - (i * 8))));
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reads a seed written by writeRaceSeed().
+ *
+ * Params:
+ *    [in]  pBuf  - The received characters starting at the space.
+ *    [in]  len   - Number of received characters from pBuf on.
+ *    [out] pSeed - The seed, only written when it is valid.
+ *
+ * Return: TRUE if the characters hold a seed
+ *
+ ****************************************************************************/
+
+static tBool readRaceSeed(tU8 *pBuf, tU8 len, tU32 *pSeed)
+{
+  tU32 seed = 0;
+  tU8 value;
+  tU8 i;
+
+  if ((len < (tU8)RACE_SEED_LEN) || (pBuf[0] != ' ')) {
+    return FALSE;
+  }
+  for (i = 0; i < (tU8)4; ++i) {
+    if (decodeFromDigits(&pBuf[1 + (i * 2)], &value) == (tBool)FALSE) {
+      return FALSE;
+    }
+    seed = (seed << 8) | value;
+  }
+  *pSeed = seed;
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Sends a move that changed the board, "M" and the direction.
+ *
+ ****************************************************************************/
+
+static void sendRaceMove(tU8 dir)
+{
+  tU8 buf[3];
+
+  buf[0] = 'M';
+  buf[1] = (tU8)('0' + dir);
+  buf[2] = 0x0a;
+  uart1SendChars((char *) buf, 3);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays the moves received from the other board on its local copy and
+ *    shows who leads with the LEDs. Does not wait for characters.
+ *
+ * Return: FALSE if the connection is lost
+ *
+ ****************************************************************************/
+
+static tBool receiveRace(void)
+{
+  tU8 rxChar;
+
+  while (uart1GetChar(&rxChar) == (tU8)TRUE) {
+    if (rxChar != (tU8)0x0a) {
+      if (recvPos < (tU8)RECV_BUF_LEN) {
+        recvBuf[recvPos] = rxChar;
+        recvPos++;
+      }
+      continue;
+    }
+
+    if ((recvPos >= (tU8)2) && (recvBuf[0] == 'M') &&
+        (recvBuf[1] >= '0') && (recvBuf[1] <= '3')) {
+      engineStep(&oppGame, (tU8)(recvBuf[1] - '0'));
+      showOpponent();
+
+      if (oppGame.score > game.score) {
+        setLED(LED_GREEN, FALSE);
+        setLED(LED_RED,   TRUE);
+      } else {
+        setLED(LED_GREEN, TRUE);
+        setLED(LED_RED,   FALSE);
+      }
+    } else if ((recvPos >= (tU8)10) && (memcmp(recvBuf, "NO CARRIER", 10) == 0)) {
+      recvPos = 0;
+      return FALSE;
+    }
+    recvPos = 0;
+  }
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Shows the largest tile of the other board left of the title.
+ *
+ ****************************************************************************/
+
+static void showOpponent(void)
+{
+  lcdColor(0, 0x1f);
+  lcdGotoxy(0, 0);
+  lcdPuts((const tU8 *) "    ");
+  lcdGotoxy(0, 0);
+  lcdPuts(tileGlyph[oppGame.maxTile]);
+  lcdColor(0, 0xe0);
+}
+
+/******************************************************************************
+ ******************************************************************************
+ * BLUETOOTH HANDLING PARTS
+ ******************************************************************************
+ *****************************************************************************/
+#define RECV_BUF_LEN 40
+static tU8 recvPos;
+static tU8 recvBuf[RECV_BUF_LEN];
+
+
+/******************************************************************************
+ * Activate server functionality
+ *****************************************************************************/
+static void
+activateServer()
+{
+  osSleep(100);
+  uart1SendString((const tU8 *) "+++");
+  osSleep(100);
+  uart1SendString((const tU8 *) "AT+BTCAN\r");
+  osSleep(50);
+  uart1SendString((const tU8 *) "AT+BTSRV=20,\"2048Server\"\r");
+  recvPos = 0;
+}
+
+/******************************************************************************
+ * Return: TRUE if connection established
+ *         FALSE if no connection established
+ *****************************************************************************/
+static tBool
+checkIfClinetConnected(tU8 *pBtAddr)
+{
+  tU8 rxChar;
+
+  //check if any character has been received from BT
+  if (uart1GetChar(&rxChar) == (tU8)TRUE)
+  {
+    printf("%c", rxChar);
+
+    if (rxChar == (tU8)0x0a)
+    {
+      if (recvPos > (tU8)0){
+        recvBuf[recvPos-(tU8)1] = '\0';
+      }
+
+      //evaluate received bytes
+      if ((memcmp(recvBuf, "CONNECT ", 8) == 0) && (recvPos == (tU8)21))
+      {
+        for (recvPos=(tU8)0; recvPos<(tU8)12; recvPos++)
+        {
+          *pBtAddr = recvBuf[recvPos + (tU8)8];
+          pBtAddr++;
+        }
+        *pBtAddr = '\0';
+
+        return TRUE;
+      }
+      recvPos = 0;
+    }
+    else if (recvPos < (tU8)RECV_BUF_LEN) {
+      recvBuf[recvPos] = rxChar;
+      recvPos++;
+    }
+  }
+
+  //no connection established
+  return FALSE;
+}
+
+
+/******************************************************************************
+ * Return: TRUE if connection succeeded
+ *         FALSE if connection failed
+ *****************************************************************************/
+static tBool
+connectToServer(tU8 *pBtAddr)
+{
+  volatile tU32 timeStamp;
+  tU8 connected;
+  tU8 rxChar;
+  tU32 cnt = 0;
+
+  osSleep(100);
+  uart1SendString((const tU8 *) "+++");
+  osSleep(100);
+  uart1SendString((const tU8 *) "AT+BTCAN\r");
+  osSleep(50);
   uart1SendString((const tU8 *) "AT+BTCLT=\"");
   uart1SendString((const tU8 *)pBtAddr);
   uart1SendString((const tU8 *) "\",20,3\r");
@@ -837,8 +1776,19 @@ connectToServer(tU8 *pBtAddr)
             recvBuf[recvPos-(tU8)1] = '\0';
         }
           //evaluate received bytes
-          if (memcmp(recvBuf, "LETS START PLAYING", 18) == 0)
+          if (memcmp(recvBuf, RACE_START, RACE_START_LEN) == 0)
           {
+            //a server without a seed plays the score exchange
+            raceMode = FALSE;
+            if (recvPos > (tU8)RACE_START_LEN) {
+              raceMode = readRaceSeed(&recvBuf[RACE_START_LEN], recvPos - RACE_START_LEN, &raceSeed);
+            }
+            if (raceMode == (tBool)TRUE) {
+              sendRaceAck();
+              raceMode = waitRaceLine((const tU8 *) RACE_GO, RACE_GO_LEN);
+            }
+            //the moves of the race are read from an empty buffer
+            recvPos = 0;
             return TRUE;
           }
           else if ((memcmp(recvBuf, "NO CARRIER", 10) == 0))
@@ -1214,7 +2164,7 @@ void startGameAsServer(void)
 
           switch (drawMenu(menu))
           {
-          case 0: uart1SendString((const tU8 *) "\nLETS START PLAYING\n"); done = FALSE; break;  //start playing as server
+          case 0: sendRaceStart(); done = FALSE; break;  //start playing as server
           case 1: uart1SendString((const tU8 *) "+++"); done = TRUE; break;                      //refuse connection attempt and cancel game
           default: break;
           }
@@ -1298,7 +2248,7 @@ void startGameAsClient(void)
     else {
       done = TRUE;
     }
-    if (done == (tBool)TRUE) {
+    if (done == (tBool)FALSE) {
     play2048(gameType);
     }
 }
@@ -1389,9 +2339,8 @@ static void convertToDigits(tU8 *pBuf, tU8 value)
                                 '8', '9', 'A', 'B',
                                 'C', 'D', 'E', 'F'};
 
-  *pBuf = toHex[value >> 4];
-  *pBuf += 1;
-  *pBuf = toHex[value & (tU8)0x0f];
+  pBuf[0] = toHex[value >> 4];
+  pBuf[1] = toHex[value & (tU8)0x0f];
 }
 
 /*****************************************************************************
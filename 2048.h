@@ -14,6 +14,8 @@
 #define _2048_H_
 
 void play2048(tU8 gameType);
+void startSingleGame(void);
+void resumeGame(void);
 
 void startGameAsServer(void);
 void startGameAsClient(void);
@@ -0,0 +1,486 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    ai.c
+ *
+ * Description:
+ *    Implements an expectimax search over the packed board. Own moves are
+ *    max nodes, tile spawns are chance nodes (a 2 with 90 %, a 4 with
+ *    10 %). All arithmetic is integer since the ARM7 has no FPU.
+ *
+ *    With the heuristic the leaves are boards after the spawn. The n-tuple
+ *    network values afterstates, so with it the leaves are the boards
+ *    after the last move and every move adds the points of its merges.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "ai.h"
+#include "ai_kernel.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+/* Number of searched positions between two calls of pAbort and pClock */
+#define AI_ABORT_INTERVAL  64
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static void startSearch(tAiSearch *pSearch);
+static tU8 searchRoot(tAiSearch *pSearch, tBoard board, tU8 depth);
+static tS32 maxNode(tAiSearch *pSearch, tBoard board, tU8 depth);
+static tS32 chanceNode(tAiSearch *pSearch, tBoard board, tU8 depth);
+static tBool checkStop(tAiSearch *pSearch);
+static tAiEntry *tableSlot(tAiTable *pTable, tBoard board);
+static tU16 ntupleIndex(tU16 line);
+static tS32 boardPoints(tBoard board);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Searches the move with the highest expected board value.
+ *
+ * Params:
+ *    [in/out] pSearch - Search depth, limits and callbacks, gets statistics.
+ *    [in]     board   - The position to move from.
+ *
+ * Return: ENGINE_UP, ENGINE_RIGHT, ENGINE_DOWN or ENGINE_LEFT,
+ *         AI_NO_MOVE if no move is possible or the search was stopped
+ *
+ ****************************************************************************/
+
+tU8 aiBestMove(tAiSearch *pSearch, tBoard board)
+{
+  tU8 best;
+
+  startSearch(pSearch);
+  best = searchRoot(pSearch, board, pSearch->depth);
+  if ((pSearch->aborted == (tBool)TRUE) || (pSearch->timedOut == (tBool)TRUE)) {
+    return AI_NO_MOVE;
+  }
+  pSearch->reached = pSearch->depth;
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Searches one, two, ... pSearch->depth moves ahead until the time
+ *    limit is reached. A search cut short by the limit is thrown away,
+ *    the move of the deepest completed search is returned.
+ *
+ * Params:
+ *    [in/out] pSearch - Search depth, limits and callbacks, gets statistics.
+ *    [in]     board   - The position to move from.
+ *
+ * Return: ENGINE_UP, ENGINE_RIGHT, ENGINE_DOWN or ENGINE_LEFT,
+ *         AI_NO_MOVE if no move is possible or pAbort stopped the search
+ *
+ ****************************************************************************/
+
+tU8 aiIterativeMove(tAiSearch *pSearch, tBoard board)
+{
+  tU8 best = AI_NO_MOVE;
+  tU8 move;
+  tU8 depth;
+
+  startSearch(pSearch);
+  for (depth = 1; depth <= pSearch->depth; ++depth) {
+    move = searchRoot(pSearch, board, depth);
+    if (pSearch->aborted == (tBool)TRUE) {
+      return AI_NO_MOVE;
+    }
+    if (pSearch->timedOut == (tBool)TRUE) {
+      break;
+    }
+    best = move;
+    pSearch->reached = depth;
+    if (best == (tU8)AI_NO_MOVE) {
+      break;
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Value of a position. The heuristic is the sum of the values of the
+ *    four rows and four columns; columns are scored as rows of the
+ *    transposed board, so with the row table this is eight table reads.
+ *    The n-tuple network sums the weights of its 16 features, the points
+ *    still to be gained from an afterstate.
+ *
+ ****************************************************************************/
+
+tS32 aiEvaluate(tBoard board)
+{
+#if defined(AI_EVAL_NTUPLE)
+  tU16 features[AI_NTUPLE_FEATURES];
+  tS32 sum = 0;
+  tU8 i;
+
+  aiNtupleFeatures(board, features);
+  for (i = 0; i < (tU8)(AI_NTUPLE_FEATURES / 2); ++i) {
+    sum += aiNtupleLevels[aiNtupleWeights[0][features[i]]];
+    sum += aiNtupleLevels[aiNtupleWeights[1][features[i + (AI_NTUPLE_FEATURES / 2)]]];
+  }
+  return sum;
+#else
+  tBoard t = engineTranspose(board);
+
+#if defined(ENGINE_TABLES_FULL)
+  return aiRowScore[(tU16)board] + aiRowScore[(tU16)(board >> 16)] +
+         aiRowScore[(tU16)(board >> 32)] + aiRowScore[(tU16)(board >> 48)] +
+         aiRowScore[(tU16)t] + aiRowScore[(tU16)(t >> 16)] +
+         aiRowScore[(tU16)(t >> 32)] + aiRowScore[(tU16)(t >> 48)];
+#else
+  return aiLineScore((tU16)board) + aiLineScore((tU16)(board >> 16)) +
+         aiLineScore((tU16)(board >> 32)) + aiLineScore((tU16)(board >> 48)) +
+         aiLineScore((tU16)t) + aiLineScore((tU16)(t >> 16)) +
+         aiLineScore((tU16)(t >> 32)) + aiLineScore((tU16)(t >> 48));
+#endif
+#endif
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Computes the weight indices of the n-tuple network: the outer rows
+ *    and columns, then the inner ones, each read in both directions.
+ *    Shared by the evaluator and the trainer.
+ *
+ * Params:
+ *    [in]  board     - The position.
+ *    [out] pFeatures - AI_NTUPLE_FEATURES indices, the first half into
+ *                      the weights of tuple 0, the second half tuple 1.
+ *
+ ****************************************************************************/
+
+void aiNtupleFeatures(tBoard board, tU16 *pFeatures)
+{
+  tBoard mirror = engineTransform(board, ENGINE_SYM_MIRROR_X);
+  tBoard t = engineTranspose(board);
+  tBoard tMirror = engineTransform(t, ENGINE_SYM_MIRROR_X);
+  tU8 i;
+
+  for (i = 0; i < (tU8)2; ++i) {
+    //line 0 and 3 are outer lines, 1 and 2 inner ones
+    tU8 outer = (tU8)(i * 48);
+    tU8 inner = (tU8)(16 + (i * 16));
+
+    pFeatures[i]      = ntupleIndex((tU16)(board >> outer));
+    pFeatures[i + 2]  = ntupleIndex((tU16)(mirror >> outer));
+    pFeatures[i + 4]  = ntupleIndex((tU16)(t >> outer));
+    pFeatures[i + 6]  = ntupleIndex((tU16)(tMirror >> outer));
+    pFeatures[i + 8]  = ntupleIndex((tU16)(board >> inner));
+    pFeatures[i + 10] = ntupleIndex((tU16)(mirror >> inner));
+    pFeatures[i + 12] = ntupleIndex((tU16)(t >> inner));
+    pFeatures[i + 14] = ntupleIndex((tU16)(tMirror >> inner));
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Heuristic value of one line of four cells: rewards empty cells and
+ *    equal neighbours, penalizes lines that are not monotonic and large
+ *    tiles that are not yet merged.
+ *
+ ****************************************************************************/
+
+tS32 aiLineScore(tU16 line)
+{
+  return aiLineKernel(line);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Points of a move, the values of the tiles its merges built.
+ *
+ ****************************************************************************/
+
+tS32 aiMovePoints(tBoard before, tBoard after)
+{
+  return boardPoints(after) - boardPoints(before);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Empties a transposition table and resets its counters.
+ *
+ ****************************************************************************/
+
+void aiTableClear(tAiTable *pTable)
+{
+  tU32 i;
+
+  pTable->age = 0;
+  pTable->hits = 0;
+  pTable->misses = 0;
+  pTable->evictions = 0;
+  for (i = 0; i < AI_TT_ENTRIES; ++i) {
+    pTable->entries[i].age = 0;
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Clears the results and sets the deadline of a new search.
+ *
+ ****************************************************************************/
+
+static void startSearch(tAiSearch *pSearch)
+{
+  pSearch->aborted = FALSE;
+  pSearch->timedOut = FALSE;
+  pSearch->reached = 0;
+  pSearch->nodes = 0;
+  if (pSearch->pClock != NULL) {
+    pSearch->deadline = pSearch->pClock() + pSearch->budget;
+  }
+  if (pSearch->pTable != NULL) {
+    if (++pSearch->pTable->age == 0) {
+      pSearch->pTable->age = 1;
+    }
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Searches the best move depth moves ahead.
+ *
+ ****************************************************************************/
+
+static tU8 searchRoot(tAiSearch *pSearch, tBoard board, tU8 depth)
+{
+  tU8 best = AI_NO_MOVE;
+  tS32 bestScore = AI_LOST_SCORE - 1;
+  tS32 value;
+  tBoard next;
+  tU8 merges;
+  tU8 dir;
+
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    next = engineMove(board, dir, &merges);
+    if (next == board) {
+      continue;
+    }
+
+    value = chanceNode(pSearch, next, (tU8)(depth - 1));
+    if ((pSearch->aborted == (tBool)TRUE) || (pSearch->timedOut == (tBool)TRUE)) {
+      return AI_NO_MOVE;
+    }
+#if defined(AI_EVAL_NTUPLE)
+    value += aiMovePoints(board, next);
+#endif
+    if (value > bestScore) {
+      bestScore = value;
+      best = dir;
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Value of the best own move, the heuristic value at the search horizon.
+ *
+ ****************************************************************************/
+
+static tS32 maxNode(tAiSearch *pSearch, tBoard board, tU8 depth)
+{
+  tS32 best = AI_LOST_SCORE;
+  tS32 value;
+  tBoard next;
+  tU8 merges;
+  tU8 dir;
+
+  if (checkStop(pSearch) == (tBool)TRUE) {
+    return AI_LOST_SCORE;
+  }
+  if (depth == (tU8)0) {
+    return aiEvaluate(board);
+  }
+
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    next = engineMove(board, dir, &merges);
+    if (next != board) {
+      value = chanceNode(pSearch, next, (tU8)(depth - 1));
+#if defined(AI_EVAL_NTUPLE)
+      value += aiMovePoints(board, next);
+#endif
+      if (value > best) {
+        best = value;
+      }
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Expected value over all spawns: every empty cell is equally likely
+ *    and gets a 2 nine times out of ten.
+ *
+ ****************************************************************************/
+
+static tS32 chanceNode(tAiSearch *pSearch, tBoard board, tU8 depth)
+{
+  tU16 empty = engineEmptyMask(board);
+  tU8 count = enginePopCount(empty);
+  tAiTable *pTable = pSearch->pTable;
+  tAiEntry *pEntry = NULL;
+  tBoard key = board;
+  tS32 sum = 0;
+  tS32 value;
+  tU8 cell;
+
+#if defined(AI_EVAL_NTUPLE)
+  //the network values the afterstate itself
+  if (depth == (tU8)0) {
+    return aiEvaluate(board);
+  }
+#endif
+
+  if (pTable != NULL) {
+    //symmetric positions have the same value and share one entry
+    key = engineCanonical(board, NULL);
+    pEntry = tableSlot(pTable, key);
+    if ((pEntry->age != 0) && (pEntry->board == key) && (pEntry->depth >= depth)) {
+      pTable->hits++;
+      return pEntry->value;
+    }
+    pTable->misses++;
+  }
+
+  if (count == (tU8)0) {
+    value = maxNode(pSearch, board, depth);
+  } else {
+    for (cell = 0; cell < (tU8)ENGINE_CELLS; ++cell) {
+      if ((empty & (1 << cell)) != 0) {
+        sum += 9 * maxNode(pSearch, board | ((tBoard)1 << (cell * 4)), depth);
+        sum += 1 * maxNode(pSearch, board | ((tBoard)2 << (cell * 4)), depth);
+      }
+    }
+    value = sum / (10 * count);
+  }
+
+  //values of a stopped search are meaningless and must not be stored
+  if ((pEntry != NULL) &&
+      (pSearch->aborted == (tBool)FALSE) && (pSearch->timedOut == (tBool)FALSE) &&
+      ((pEntry->age != pTable->age) || (pEntry->depth <= depth))) {
+    if ((pEntry->age != 0) && (pEntry->board != key)) {
+      pTable->evictions++;
+    }
+    pEntry->board = key;
+    pEntry->value = value;
+    pEntry->depth = depth;
+    pEntry->age = pTable->age;
+  }
+  return value;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Counts a searched position and now and then polls the abort callback
+ *    and the clock.
+ *
+ * Return: TRUE if the search has to stop
+ *
+ ****************************************************************************/
+
+static tBool checkStop(tAiSearch *pSearch)
+{
+  pSearch->nodes++;
+  if ((pSearch->nodes % AI_ABORT_INTERVAL) == 0) {
+    if ((pSearch->aborted == (tBool)FALSE) && (pSearch->pAbort != NULL)) {
+      pSearch->aborted = pSearch->pAbort();
+    }
+    if ((pSearch->timedOut == (tBool)FALSE) && (pSearch->pClock != NULL) &&
+        ((tS32)(pSearch->pClock() - pSearch->deadline) >= 0)) {
+      pSearch->timedOut = TRUE;
+    }
+  }
+  return ((pSearch->aborted == (tBool)TRUE) || (pSearch->timedOut == (tBool)TRUE));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Hashes a board to its transposition table entry. The 64-bit board is
+ *    folded first since the ARM7 only multiplies 32 bits fast.
+ *
+ ****************************************************************************/
+
+static tAiEntry *tableSlot(tAiTable *pTable, tBoard board)
+{
+  tU32 key = (tU32)board ^ ((tU32)(board >> 32) * (tU32)0x85ebca6b);
+
+  key *= (tU32)0x9e3779b1;
+  return &pTable->entries[key >> (32 - AI_TT_BITS)];
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Base 12 index of a line with its exponents clamped to 11.
+ *
+ ****************************************************************************/
+
+static tU16 ntupleIndex(tU16 line)
+{
+  tU16 index = 0;
+  tU8 tile;
+  tU8 k;
+
+  for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+    tile = (tU8)((line >> ((ENGINE_SIZE - 1 - k) * 4)) & 0x0f);
+    if (tile > (tU8)(AI_NTUPLE_BASE - 1)) {
+      tile = AI_NTUPLE_BASE - 1;
+    }
+    index = (tU16)((index * AI_NTUPLE_BASE) + tile);
+  }
+  return index;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Points potential of a board: a tile 2^e counts (e-1) * 2^e, which is
+ *    what its merges were worth. Sliding keeps the potential and a merge
+ *    raises it by the value of the merged tile.
+ *
+ ****************************************************************************/
+
+static tS32 boardPoints(tBoard board)
+{
+  tS32 sum = 0;
+  tU8 tile;
+  tU8 k;
+
+  for (k = 0; k < (tU8)ENGINE_CELLS; ++k) {
+    tile = (tU8)(board & 0x0f);
+    if (tile > (tU8)1) {
+      sum += (tS32)(tile - 1) << tile;
+    }
+    board >>= 4;
+  }
+  return sum;
+}
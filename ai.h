@@ -0,0 +1,143 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    ai.h
+ *
+ * Description:
+ *    Expose the expectimax search suggesting the best next move.
+ *
+ *****************************************************************************/
+#ifndef _AI_H_
+#define _AI_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "../pre_emptive_os/api/general.h"
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define AI_NO_MOVE 0xff
+
+/*
+ * Heuristic weights, see aiLineScore(). They can be overridden with -D,
+ * the makefiles pass AI_WEIGHTS to the compiler and to host/gentables.
+ */
+#ifndef AI_BASE_SCORE
+#define AI_BASE_SCORE      200000
+#endif
+#ifndef AI_EMPTY_WEIGHT
+#define AI_EMPTY_WEIGHT    270
+#endif
+#ifndef AI_MERGE_WEIGHT
+#define AI_MERGE_WEIGHT    700
+#endif
+#ifndef AI_MONO_WEIGHT
+#define AI_MONO_WEIGHT     47
+#endif
+#ifndef AI_SUM_WEIGHT
+#define AI_SUM_WEIGHT      11
+#endif
+
+/*
+ * Heuristic value of every row, generated by host/gentables from
+ * aiLineScore() for ENGINE_TABLES_FULL builds. Without it the rows are
+ * scored directly.
+ */
+#if defined(ENGINE_TABLES_FULL)
+extern const tS32 aiRowScore[ENGINE_ROW_ENTRIES];
+#endif
+
+/*
+ * N-tuple network evaluator, used instead of the heuristic with
+ * AI_EVAL_NTUPLE. Tuple 0 is an outer line of the board, tuple 1 an inner
+ * line, both read in all 8 symmetric placements. Exponents are clamped to
+ * 11, so a tuple has 12^4 weights. The weights are trained by host/train
+ * to predict the points still to be gained from an afterstate (the board
+ * after a move, before the spawn). A weight is stored as an 8 bit code
+ * into a table of AI_NTUPLE_LEVELS values in points chosen by the trainer.
+ */
+#define AI_NTUPLE_TUPLES  2
+#define AI_NTUPLE_BASE    12
+#define AI_NTUPLE_ENTRIES (AI_NTUPLE_BASE * AI_NTUPLE_BASE * \
+                           AI_NTUPLE_BASE * AI_NTUPLE_BASE)
+#define AI_NTUPLE_LEVELS  256
+
+#if defined(AI_EVAL_NTUPLE)
+extern const tS32 aiNtupleLevels[AI_NTUPLE_LEVELS];
+extern const tU8  aiNtupleWeights[AI_NTUPLE_TUPLES][AI_NTUPLE_ENTRIES];
+#endif
+
+/* Board value of a position without any possible move, below any aiEvaluate() */
+#define AI_LOST_SCORE (-8000000)
+
+/*
+ * The transposition table has 2^AI_TT_BITS entries of 16 bytes. It is
+ * set by the makefiles: a few KB on the target, many MB on the host.
+ */
+#ifndef AI_TT_BITS
+#define AI_TT_BITS    8
+#endif
+#define AI_TT_ENTRIES (1UL << AI_TT_BITS)
+
+/* Value of a chance node, searched depth own moves ahead, by canonical board */
+typedef struct
+{
+  tBoard board;
+  tS32   value;
+  tU8    depth;
+  tU8    age;               /* search that stored the entry, 0 if unused */
+} tAiEntry;
+
+/*
+ * Transposition table. It must be statically allocated, there is no heap.
+ * Entries of older searches are always replaced, entries of the running
+ * search only by results of the same or a deeper search.
+ */
+typedef struct
+{
+  tU8      age;             /* number of the running search */
+  tU32     hits;
+  tU32     misses;
+  tU32     evictions;       /* entries replaced by another position */
+  tAiEntry entries[AI_TT_ENTRIES];
+} tAiTable;
+
+/*
+ * Search parameters and results. With a pClock the search stops once
+ * budget milliseconds have passed since the start of the call.
+ */
+typedef struct
+{
+  tU8   depth;              /* number of own moves to look ahead, the last
+                               iteration of aiIterativeMove() */
+  tBool (*pAbort)(void);    /* polled during the search, may be NULL */
+  tU32  (*pClock)(void);    /* millisecond clock, may be NULL */
+  tAiTable *pTable;         /* transposition table, may be NULL */
+  tU32  budget;             /* time limit in milliseconds */
+  tBool aborted;            /* set when pAbort stopped the search */
+  tBool timedOut;           /* set when the time limit stopped the search */
+  tU8   reached;            /* deepest completed search */
+  tU32  nodes;              /* number of searched positions */
+  tU32  deadline;           /* clock value at which the search stops */
+} tAiSearch;
+
+
+tU8  aiBestMove(tAiSearch *pSearch, tBoard board);
+tU8  aiIterativeMove(tAiSearch *pSearch, tBoard board);
+tS32 aiEvaluate(tBoard board);
+tS32 aiLineScore(tU16 line);
+tS32 aiMovePoints(tBoard before, tBoard after);
+void aiNtupleFeatures(tBoard board, tU16 *pFeatures);
+void aiTableClear(tAiTable *pTable);
+
+/* Number of features aiNtupleFeatures() writes, tuple 0 ones first */
+#define AI_NTUPLE_FEATURES 16
+
+#endif
@@ -0,0 +1,89 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    ai_kernel.h
+ *
+ * Description:
+ *    The line heuristic of the search, shared by ai.c and the C++ host
+ *    build that evaluates it at compile time (host/engine_tables.cpp).
+ *    Same rules as engine_kernel.h.
+ *
+ *****************************************************************************/
+#ifndef _AI_KERNEL_H_
+#define _AI_KERNEL_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "ai.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#if defined(__cplusplus)
+#define AI_KERNEL static constexpr
+#else
+#define AI_KERNEL static
+#endif
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Heuristic value of one line of four cells, see aiLineScore().
+ *
+ ****************************************************************************/
+
+AI_KERNEL tS32 aiLineKernel(tU16 line)
+{
+  tS32 rank[ENGINE_SIZE] = {0};
+  tS32 empty = 0;
+  tS32 merges = 0;
+  tS32 sum = 0;
+  tS32 monoLeft = 0;
+  tS32 monoRight = 0;
+  tS32 prev = 0;
+  tS32 counter = 0;
+  tU8 k = 0;
+
+  for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+    rank[k] = (line >> (k * 4)) & 0x0f;
+    sum += rank[k] * rank[k] * rank[k];
+    if (rank[k] == 0) {
+      empty++;
+    } else {
+      if (prev == rank[k]) {
+        counter++;
+      } else if (counter > 0) {
+        merges += 1 + counter;
+        counter = 0;
+      }
+      prev = rank[k];
+    }
+  }
+  if (counter > 0) {
+    merges += 1 + counter;
+  }
+
+  for (k = 1; k < (tU8)ENGINE_SIZE; ++k) {
+    tS32 a = rank[k - 1] * rank[k - 1] * rank[k - 1] * rank[k - 1];
+    tS32 b = rank[k] * rank[k] * rank[k] * rank[k];
+    if (rank[k - 1] > rank[k]) {
+      monoLeft += a - b;
+    } else {
+      monoRight += b - a;
+    }
+  }
+
+  return (AI_BASE_SCORE / 8) +
+         (AI_EMPTY_WEIGHT * empty) +
+         (AI_MERGE_WEIGHT * merges) -
+         (AI_MONO_WEIGHT * ((monoLeft < monoRight) ? monoLeft : monoRight) / 16) -
+         (AI_SUM_WEIGHT * sum);
+}
+
+#endif
@@ -0,0 +1,725 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    engine.c
+ *
+ * Description:
+ *    Implements the packed 2048 board engine. Has no dependencies on the
+ *    operating system or the board hardware.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+#include "engine_kernel.h"
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static tU16 nibbleMask(tBoard board);
+static void updateSummary(tGame *pGame, tU8 maxTile);
+#if defined(ENGINE_TABLES_FULL) || defined(ENGINE_TABLES_COMPACT)
+static tBoard slideLeft(tBoard board);
+static tBoard slideRight(tBoard board);
+#endif
+#if defined(ENGINE_TABLES_COMPACT)
+static tU16 slideCompact(tU16 row);
+#endif
+#if !defined(ENGINE_TABLES_FULL)
+static tU16 reverseRow(tU16 row);
+#endif
+#if !defined(ENGINE_TABLES_FULL) && !defined(ENGINE_TABLES_COMPACT)
+static tU16 getColumn(tBoard board, tU8 x);
+static tBoard setColumn(tBoard board, tU8 x, tU16 column);
+#endif
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Starts a new game with two tiles. Games started with the same seed
+ *    and played with the same moves get the same spawns.
+ *
+ ****************************************************************************/
+
+void engineNewGame(tGame *pGame, tU32 seed)
+{
+  rngSeed(&pGame->rng, seed);
+  pGame->score = 0;
+  pGame->board = engineSpawn(0, rngNext(&pGame->rng));
+  pGame->board = engineSpawn(pGame->board, rngNext(&pGame->rng));
+  updateSummary(pGame, engineMaxTile(pGame->board));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays one move: moves the tiles, adds the merges to the score and
+ *    spawns a new tile. A move that changes nothing does not spawn and
+ *    does not advance the random number generator. The board summary is
+ *    updated with a fixed number of word operations, so engineGameOver
+ *    and engineGameWon never scan the cells.
+ *
+ * Return: mask of the changed cells including the spawned one,
+ *         ENGINE_NO_MOVE if nothing moved
+ *
+ ****************************************************************************/
+
+tU16 engineStep(tGame *pGame, tU8 dir)
+{
+  tBoard before = pGame->board;
+  tU8 merges = 0;
+
+  if (engineApplyMove(&pGame->board, dir, &merges) == (tU16)ENGINE_NO_MOVE) {
+    return ENGINE_NO_MOVE;
+  }
+  pGame->score += merges;
+  pGame->board = engineSpawn(pGame->board, rngNext(&pGame->rng));
+
+  //a move merges two tiles at most one step above the old maximum, 15 is the largest
+  if ((pGame->maxTile < (tU8)(ENGINE_TILES - 1)) &&
+      (engineHasTile(pGame->board, (tU8)(pGame->maxTile + 1)) == (tBool)TRUE)) {
+    updateSummary(pGame, (tU8)(pGame->maxTile + 1));
+  } else {
+    updateSummary(pGame, pGame->maxTile);
+  }
+  return engineChangedCells(before, pGame->board);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Puts a board into a game, e.g. one saved earlier, and brings the
+ *    board summary up to date. Score and generator are left alone.
+ *
+ ****************************************************************************/
+
+void engineSetBoard(tGame *pGame, tBoard board)
+{
+  pGame->board = board;
+  updateSummary(pGame, engineMaxTile(board));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Slides one line of four cells towards nibble 0 (the low nibble) in a
+ *    single pass. Every tile moves as far as it can and two equal tiles
+ *    merge into one, each tile taking part in at most one merge.
+ *    This is the reference kernel the row lookup tables are generated from.
+ *
+ * Params:
+ *    [in]  row     - Four packed exponents, nibble 0 is the target side.
+ *    [out] pMerges - Incremented once per merge.
+ *
+ * Return: the slid line, equal to row if nothing could move
+ *
+ ****************************************************************************/
+
+tU16 engineSlideRow(tU16 row, tU8 *pMerges)
+{
+  return engineSlideKernel(row, pMerges);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves all tiles of the board in the given direction.
+ *
+ * Params:
+ *    [in]  board   - The packed board.
+ *    [in]  dir     - ENGINE_UP, ENGINE_RIGHT, ENGINE_DOWN or ENGINE_LEFT.
+ *    [out] pMerges - Incremented once per merge.
+ *
+ * Return: the board after the move
+ *
+ ****************************************************************************/
+
+tBoard engineMove(tBoard board, tU8 dir, tU8 *pMerges)
+{
+#if defined(ENGINE_TABLES_FULL) || defined(ENGINE_TABLES_COMPACT)
+  tBoard result;
+
+  switch (dir) {
+    case ENGINE_LEFT:
+      result = slideLeft(board);
+      break;
+
+    case ENGINE_RIGHT:
+      result = slideRight(board);
+      break;
+
+    case ENGINE_UP:
+      result = engineTranspose(slideLeft(engineTranspose(board)));
+      break;
+
+    case ENGINE_DOWN:
+      result = engineTranspose(slideRight(engineTranspose(board)));
+      break;
+
+    default:
+      return board;
+  }
+
+  //every merge removes exactly one tile
+  *pMerges += (tU8)(engineCountTiles(board) - engineCountTiles(result));
+  return result;
+#else
+  tBoard result = 0;
+  tU16 line;
+  tU8 i;
+
+  for (i = 0; i < (tU8)ENGINE_SIZE; ++i) {
+    switch (dir) {
+      case ENGINE_LEFT:
+        line = (tU16)(board >> (i * 16));
+        result |= (tBoard)engineSlideRow(line, pMerges) << (i * 16);
+        break;
+
+      case ENGINE_RIGHT:
+        line = reverseRow((tU16)(board >> (i * 16)));
+        result |= (tBoard)reverseRow(engineSlideRow(line, pMerges)) << (i * 16);
+        break;
+
+      case ENGINE_UP:
+        line = getColumn(board, i);
+        result = setColumn(result, i, engineSlideRow(line, pMerges));
+        break;
+
+      case ENGINE_DOWN:
+        line = reverseRow(getColumn(board, i));
+        result = setColumn(result, i, reverseRow(engineSlideRow(line, pMerges)));
+        break;
+
+      default:
+        return board;
+    }
+  }
+
+  return result;
+#endif
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves all tiles of the board in place and reports which cells changed.
+ *
+ * Params:
+ *    [in/out] pBoard  - The packed board.
+ *    [in]     dir     - ENGINE_UP, ENGINE_RIGHT, ENGINE_DOWN or ENGINE_LEFT.
+ *    [out]    pMerges - Incremented once per merge.
+ *
+ * Return: mask of the changed cells, ENGINE_NO_MOVE if nothing moved
+ *
+ ****************************************************************************/
+
+tU16 engineApplyMove(tBoard *pBoard, tU8 dir, tU8 *pMerges)
+{
+  tBoard before = *pBoard;
+
+  *pBoard = engineMove(before, dir, pMerges);
+  return engineChangedCells(before, *pBoard);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Compares two boards cell by cell.
+ *
+ * Return: mask of the cells holding different tiles
+ *
+ ****************************************************************************/
+
+tU16 engineChangedCells(tBoard before, tBoard after)
+{
+  return nibbleMask(before ^ after);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Places a new tile in one of the empty cells. The cell is picked from
+ *    the empty cell mask without scanning the board, so the cost does not
+ *    depend on how full the board is.
+ *
+ * Params:
+ *    [in] board - The packed board.
+ *    [in] rnd   - A random number. Bits 0..15 select the empty cell,
+ *                 bits 16..30 select a 2 (90 %) or a 4 (10 %).
+ *
+ * Return: the board with the new tile, unchanged if the board is full
+ *
+ ****************************************************************************/
+
+tBoard engineSpawn(tBoard board, tU32 rnd)
+{
+  tU16 empty = engineEmptyMask(board);
+  tU8 count = enginePopCount(empty);
+  tU8 cell;
+  tU8 tile = 1;
+
+  if (count == (tU8)0) {
+    return board;
+  }
+
+  //scale instead of modulo, the ARM7 has no divide instruction
+  cell = engineSelectBit(empty, (tU8)(((rnd & 0xffff) * count) >> 16));
+  if (((rnd >> 16) & 0x7fff) < (tU32)ENGINE_FOUR_CHANCE) {
+    tile = 2;
+  }
+  return board | ((tBoard)tile << (cell * 4));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Builds the mask of the empty cells, bit y*4+x for cell (y, x).
+ *
+ ****************************************************************************/
+
+tU16 engineEmptyMask(tBoard board)
+{
+  return (tU16)~nibbleMask(board);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Counts the set bits of a cell mask.
+ *
+ ****************************************************************************/
+
+tU8 enginePopCount(tU16 mask)
+{
+  tU32 m = mask;
+
+  m = m - ((m >> 1) & 0x5555);
+  m = (m & 0x3333) + ((m >> 2) & 0x3333);
+  m = (m + (m >> 4)) & 0x0f0f;
+  return (tU8)((m + (m >> 8)) & 0x1f);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Finds the n-th set bit of a cell mask (n counted from 0) by halving
+ *    the search window four times.
+ *
+ * Return: index of the bit, n must be below the number of set bits
+ *
+ ****************************************************************************/
+
+tU8 engineSelectBit(tU16 mask, tU8 n)
+{
+  tU8 pos = 0;
+  tU8 c;
+
+  c = enginePopCount((tU16)(mask & 0xff));
+  if (n >= c) {
+    n -= c;
+    mask >>= 8;
+    pos += 8;
+  }
+  c = enginePopCount((tU16)(mask & 0x0f));
+  if (n >= c) {
+    n -= c;
+    mask >>= 4;
+    pos += 4;
+  }
+  c = enginePopCount((tU16)(mask & 0x03));
+  if (n >= c) {
+    n -= c;
+    mask >>= 2;
+    pos += 2;
+  }
+  if (n >= (tU8)(mask & 0x01)) {
+    pos += 1;
+  }
+  return pos;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Counts the empty cells of the board.
+ *
+ ****************************************************************************/
+
+tU8 engineCountEmpty(tBoard board)
+{
+  return (tU8)(ENGINE_CELLS - engineCountTiles(board));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Counts the occupied cells of the board without looping over them.
+ *    Every nibble is first folded into its lowest bit, then the bits are
+ *    summed bytewise by a single multiplication.
+ *
+ ****************************************************************************/
+
+tU8 engineCountTiles(tBoard board)
+{
+  board |= board >> 1;
+  board |= board >> 2;
+  board &= 0x1111111111111111ULL;
+  board = (board & 0x0101010101010101ULL) + ((board >> 4) & 0x0101010101010101ULL);
+  return (tU8)((board * 0x0101010101010101ULL) >> 56);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Swaps rows and columns of the board, cell (y, x) becomes cell (x, y).
+ *    Lets the column moves reuse the row lookup tables.
+ *
+ ****************************************************************************/
+
+tBoard engineTranspose(tBoard board)
+{
+  tBoard a1 = board & 0xf0f00f0ff0f00f0fULL;
+  tBoard a2 = board & 0x0000f0f00000f0f0ULL;
+  tBoard a3 = board & 0x0f0f00000f0f0000ULL;
+  tBoard a  = a1 | (a2 << 12) | (a3 >> 12);
+  tBoard b1 = a & 0xff00ff0000ff00ffULL;
+  tBoard b2 = a & 0x00ff00ff00000000ULL;
+  tBoard b3 = a & 0x00000000ff00ff00ULL;
+
+  return b1 | (b2 >> 24) | (b3 << 24);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Applies one of the 8 symmetries of the square to the board: first the
+ *    transpose, then the mirror of the columns, then the mirror of the rows.
+ *
+ * Params:
+ *    [in] board     - The board to transform.
+ *    [in] transform - Set of ENGINE_SYM_* flags.
+ *
+ ****************************************************************************/
+
+tBoard engineTransform(tBoard board, tU8 transform)
+{
+  if ((transform & ENGINE_SYM_TRANSPOSE) != 0) {
+    board = engineTranspose(board);
+  }
+  if ((transform & ENGINE_SYM_MIRROR_X) != 0) {
+    board = ((board & 0x0f0f0f0f0f0f0f0fULL) << 4) | ((board >> 4) & 0x0f0f0f0f0f0f0f0fULL);
+    board = ((board & 0x00ff00ff00ff00ffULL) << 8) | ((board >> 8) & 0x00ff00ff00ff00ffULL);
+  }
+  if ((transform & ENGINE_SYM_MIRROR_Y) != 0) {
+    board = ((board & 0x0000ffff0000ffffULL) << 16) | ((board >> 16) & 0x0000ffff0000ffffULL);
+    board = (board << 32) | (board >> 32);
+  }
+  return board;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Finds the smallest of the 8 symmetric boards. Symmetric positions have
+ *    the same canonical board, so caches need only one entry for them.
+ *
+ * Params:
+ *    [in]  board      - The board to canonicalize.
+ *    [out] pTransform - The engineTransform() giving the canonical board,
+ *                       may be NULL.
+ *
+ ****************************************************************************/
+
+tBoard engineCanonical(tBoard board, tU8 *pTransform)
+{
+  tBoard best = board;
+  tBoard b;
+  tU8 bestTransform = 0;
+  tU8 t;
+
+  for (t = 1; t < (tU8)ENGINE_SYMMETRIES; ++t) {
+    b = engineTransform(board, t);
+    if (b < best) {
+      best = b;
+      bestTransform = t;
+    }
+  }
+  if (pTransform != NULL) {
+    *pTransform = bestTransform;
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Maps a direction the same way engineTransform() maps the board, i.e.
+ *    moving the transformed board in the returned direction gives the
+ *    transformed result of moving the board in dir.
+ *
+ ****************************************************************************/
+
+tU8 engineTransformDir(tU8 dir, tU8 transform)
+{
+  if ((transform & ENGINE_SYM_TRANSPOSE) != 0) {
+    dir = (tU8)(ENGINE_LEFT - dir);
+  }
+  if (((transform & ENGINE_SYM_MIRROR_X) != 0) && ((dir & 1) != 0)) {
+    dir ^= 2;
+  }
+  if (((transform & ENGINE_SYM_MIRROR_Y) != 0) && ((dir & 1) == 0)) {
+    dir ^= 2;
+  }
+  return dir;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reverses engineTransformDir(), maps a move found on the transformed
+ *    (canonical) board back to the original board.
+ *
+ ****************************************************************************/
+
+tU8 engineRestoreDir(tU8 dir, tU8 transform)
+{
+  if (((transform & ENGINE_SYM_MIRROR_Y) != 0) && ((dir & 1) == 0)) {
+    dir ^= 2;
+  }
+  if (((transform & ENGINE_SYM_MIRROR_X) != 0) && ((dir & 1) != 0)) {
+    dir ^= 2;
+  }
+  if ((transform & ENGINE_SYM_TRANSPOSE) != 0) {
+    dir = (tU8)(ENGINE_LEFT - dir);
+  }
+  return dir;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Finds the tiles that can merge with their right or lower neighbour,
+ *    by comparing the board with itself shifted by one column and by one
+ *    row. Equal neighbours leave a zero nibble in the exclusive or. Empty
+ *    cells and the largest tile, which does not merge, are left out.
+ *
+ * Return: mask of the cells having an equal right or lower neighbour
+ *
+ ****************************************************************************/
+
+tU16 engineMergeMask(tBoard board)
+{
+  tU16 right = (tU16)(~nibbleMask(board ^ (board >> 4)) & 0x7777);
+  tU16 below = (tU16)(~nibbleMask(board ^ (board >> 16)) & 0x0fff);
+
+  return (tU16)((right | below) & nibbleMask(board) & nibbleMask(~board));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Checks whether any cell holds the given tile, without a loop.
+ *
+ ****************************************************************************/
+
+tBool engineHasTile(tBoard board, tU8 tile)
+{
+  return (nibbleMask(board ^ ((tBoard)tile * 0x1111111111111111ULL)) != (tU16)0xffff);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Finds the largest tile of the board.
+ *
+ * Return: exponent of the largest tile, 0 for an empty board
+ *
+ ****************************************************************************/
+
+tU8 engineMaxTile(tBoard board)
+{
+  tU8 max = 0;
+  tU8 i;
+
+  for (i = 0; i < (tU8)ENGINE_CELLS; ++i) {
+    if ((tU8)(board & 0x0f) > max) {
+      max = (tU8)(board & 0x0f);
+    }
+    board >>= 4;
+  }
+  return max;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Refreshes the empty count and the mergeable neighbours of a game.
+ *
+ ****************************************************************************/
+
+static void updateSummary(tGame *pGame, tU8 maxTile)
+{
+  pGame->empty = (tU8)(ENGINE_CELLS - engineCountTiles(pGame->board));
+  pGame->maxTile = maxTile;
+  pGame->mergeable = engineMergeMask(pGame->board);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Builds a cell mask with bit i set when nibble i is not zero. Each
+ *    nibble is folded into its lowest bit and the 16 bits, four apart, are
+ *    then gathered in four shift steps.
+ *
+ ****************************************************************************/
+
+static tU16 nibbleMask(tBoard board)
+{
+  board |= board >> 1;
+  board |= board >> 2;
+  board &= 0x1111111111111111ULL;
+  board = (board | (board >> 3))  & 0x0303030303030303ULL;
+  board = (board | (board >> 6))  & 0x000f000f000f000fULL;
+  board = (board | (board >> 12)) & 0x000000ff000000ffULL;
+  return (tU16)(board | (board >> 24));
+}
+
+#if defined(ENGINE_TABLES_FULL)
+/*****************************************************************************
+ *
+ * Description:
+ *    Looks up the left slide of each of the four rows.
+ *
+ ****************************************************************************/
+
+static tBoard slideLeft(tBoard board)
+{
+  return (tBoard)engineRowLeft[(tU16)board] |
+         ((tBoard)engineRowLeft[(tU16)(board >> 16)] << 16) |
+         ((tBoard)engineRowLeft[(tU16)(board >> 32)] << 32) |
+         ((tBoard)engineRowLeft[(tU16)(board >> 48)] << 48);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Looks up the right slide of each of the four rows.
+ *
+ ****************************************************************************/
+
+static tBoard slideRight(tBoard board)
+{
+  return (tBoard)engineRowRight[(tU16)board] |
+         ((tBoard)engineRowRight[(tU16)(board >> 16)] << 16) |
+         ((tBoard)engineRowRight[(tU16)(board >> 32)] << 32) |
+         ((tBoard)engineRowRight[(tU16)(board >> 48)] << 48);
+}
+
+#elif defined(ENGINE_TABLES_COMPACT)
+/*****************************************************************************
+ *
+ * Description:
+ *    Looks up the left slide of one row in the base 12 table. Rows holding
+ *    a tile above 2048 are not in the table and use the loop kernel.
+ *
+ ****************************************************************************/
+
+static tU16 slideCompact(tU16 row)
+{
+  tU8 merges;
+
+  //exponent 12..15 has both bit 3 and bit 2 set
+  if (((row & 0x8888) & ((row & 0x4444) << 1)) != 0) {
+    return engineSlideRow(row, &merges);
+  }
+  return engineRowCompact[(row & 0x0f) +
+                          ENGINE_ROW_BASE * (((row >> 4) & 0x0f) +
+                          ENGINE_ROW_BASE * (((row >> 8) & 0x0f) +
+                          ENGINE_ROW_BASE * (row >> 12)))];
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Slides each of the four rows to the left.
+ *
+ ****************************************************************************/
+
+static tBoard slideLeft(tBoard board)
+{
+  return (tBoard)slideCompact((tU16)board) |
+         ((tBoard)slideCompact((tU16)(board >> 16)) << 16) |
+         ((tBoard)slideCompact((tU16)(board >> 32)) << 32) |
+         ((tBoard)slideCompact((tU16)(board >> 48)) << 48);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Slides each of the four rows to the right by sliding the mirrored row.
+ *
+ ****************************************************************************/
+
+static tBoard slideRight(tBoard board)
+{
+  return (tBoard)reverseRow(slideCompact(reverseRow((tU16)board))) |
+         ((tBoard)reverseRow(slideCompact(reverseRow((tU16)(board >> 16)))) << 16) |
+         ((tBoard)reverseRow(slideCompact(reverseRow((tU16)(board >> 32)))) << 32) |
+         ((tBoard)reverseRow(slideCompact(reverseRow((tU16)(board >> 48)))) << 48);
+}
+
+#endif
+
+#if !defined(ENGINE_TABLES_FULL)
+/*****************************************************************************
+ *
+ * Description:
+ *    Reverses the order of the four nibbles of a line.
+ *
+ ****************************************************************************/
+
+static tU16 reverseRow(tU16 row)
+{
+  return (tU16)((row >> 12) | ((row >> 4) & 0x00f0) |
+                ((row << 4) & 0x0f00) | (row << 12));
+}
+#endif
+
+#if !defined(ENGINE_TABLES_FULL) && !defined(ENGINE_TABLES_COMPACT)
+/*****************************************************************************
+ *
+ * Description:
+ *    Gathers column x into a line, row 0 in nibble 0.
+ *
+ ****************************************************************************/
+
+static tU16 getColumn(tBoard board, tU8 x)
+{
+  board >>= x * 4;
+  return (tU16)((board & 0x0f) | ((board >> 12) & 0x00f0) |
+                ((board >> 24) & 0x0f00) | ((board >> 36) & 0xf000));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Scatters a line into column x, nibble 0 into row 0.
+ *
+ ****************************************************************************/
+
+static tBoard setColumn(tBoard board, tU8 x, tU16 column)
+{
+  tBoard c = (tBoard)column;
+
+  c = (c & 0x0f) | ((c & 0x00f0) << 12) |
+      ((c & 0x0f00) << 24) | ((c & 0xf000) << 36);
+  return (board & ~(0x000f000f000f000fULL << (x * 4))) | (c << (x * 4));
+}
+#endif
@@ -0,0 +1,132 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    engine.h
+ *
+ * Description:
+ *    Expose the packed 2048 board engine. The board is kept as 16 four-bit
+ *    tile exponents in one 64-bit word, cell (y, x) in nibble y*4+x.
+ *    An exponent of 0 is an empty cell, e is a tile of value 2^e.
+ *
+ *****************************************************************************/
+#ifndef _ENGINE_H_
+#define _ENGINE_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "../pre_emptive_os/api/general.h"
+#include "rng.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+typedef unsigned long long tBoard;
+
+/*
+ * Everything needed to continue or reproduce a game. empty, maxTile and
+ * mergeable summarize the board and are kept up to date by every move.
+ */
+typedef struct
+{
+  tBoard board;
+  tU16   score;      /* number of merges */
+  tRng   rng;
+  tU8    empty;      /* number of empty cells */
+  tU8    maxTile;    /* exponent of the largest tile */
+  tU16   mergeable;  /* cells equal to their right or lower neighbour */
+} tGame;
+
+#define ENGINE_UP    0
+#define ENGINE_RIGHT 1
+#define ENGINE_DOWN  2
+#define ENGINE_LEFT  3
+
+#define ENGINE_SIZE     4
+#define ENGINE_CELLS    16
+#define ENGINE_WIN_TILE 11   /* 2^11 = 2048 */
+#define ENGINE_TILES    16   /* exponents 0..15, up to 2^15 = 32768 */
+
+/*
+ * Cell masks hold one bit per cell, bit y*4+x for cell (y, x).
+ * A move returning ENGINE_NO_MOVE changed nothing and must not spawn.
+ */
+#define ENGINE_ALL_CELLS 0xffff
+#define ENGINE_NO_MOVE   0x0000
+
+/*
+ * A spawned tile is a 4 with a chance of ENGINE_FOUR_CHANCE in 32768
+ * (10 %), else a 2.
+ */
+#define ENGINE_FOUR_CHANCE 3277
+
+/*
+ * Symmetries of the board, see engineTransform(). A transform is a set of
+ * these flags, 0 to ENGINE_SYMMETRIES-1.
+ */
+#define ENGINE_SYM_MIRROR_X  1   /* reverse every row */
+#define ENGINE_SYM_MIRROR_Y  2   /* reverse every column */
+#define ENGINE_SYM_TRANSPOSE 4   /* swap rows and columns */
+#define ENGINE_SYMMETRIES    8
+
+/*
+ * Row slide lookup tables, generated at build time by host/gentables.
+ * ENGINE_TABLES_FULL maps every 16-bit row to its slid result (256 KB).
+ * ENGINE_TABLES_COMPACT only holds left slides of rows with tiles up to
+ * 2048, indexed in base 12 (40.5 KB); right slides reverse the row and
+ * rows with larger tiles fall back to the loop kernel.
+ * Without a table option the engine slides each line in a loop.
+ */
+#if defined(ENGINE_TABLES_FULL)
+#define ENGINE_ROW_ENTRIES 65536
+extern const tU16 engineRowLeft[ENGINE_ROW_ENTRIES];
+extern const tU16 engineRowRight[ENGINE_ROW_ENTRIES];
+#elif defined(ENGINE_TABLES_COMPACT)
+#define ENGINE_ROW_BASE    12
+#define ENGINE_ROW_ENTRIES (ENGINE_ROW_BASE * ENGINE_ROW_BASE * \
+                            ENGINE_ROW_BASE * ENGINE_ROW_BASE)
+extern const tU16 engineRowCompact[ENGINE_ROW_ENTRIES];
+#endif
+
+#define engineGameOver(pGame) \
+  (((pGame)->empty == 0) && ((pGame)->mergeable == 0))
+
+#define engineGameWon(pGame) \
+  ((pGame)->maxTile >= ENGINE_WIN_TILE)
+
+#define engineGetCell(board, y, x) \
+  ((tU8)(((board) >> ((((y) * ENGINE_SIZE) + (x)) * 4)) & 0x0f))
+
+#define engineSetCell(board, y, x, tile) \
+  (((board) & ~((tBoard)0x0f << ((((y) * ENGINE_SIZE) + (x)) * 4))) | \
+   ((tBoard)(tile) << ((((y) * ENGINE_SIZE) + (x)) * 4)))
+
+
+void   engineNewGame(tGame *pGame, tU32 seed);
+tU16   engineStep(tGame *pGame, tU8 dir);
+void   engineSetBoard(tGame *pGame, tBoard board);
+
+tU16   engineSlideRow(tU16 row, tU8 *pMerges);
+tBoard engineMove(tBoard board, tU8 dir, tU8 *pMerges);
+tU16   engineApplyMove(tBoard *pBoard, tU8 dir, tU8 *pMerges);
+tU16   engineChangedCells(tBoard before, tBoard after);
+tBoard engineSpawn(tBoard board, tU32 rnd);
+tU16   engineEmptyMask(tBoard board);
+tU8    enginePopCount(tU16 mask);
+tU8    engineSelectBit(tU16 mask, tU8 n);
+tU8    engineCountEmpty(tBoard board);
+tU8    engineMaxTile(tBoard board);
+tU16   engineMergeMask(tBoard board);
+tBool  engineHasTile(tBoard board, tU8 tile);
+tU8    engineCountTiles(tBoard board);
+tBoard engineTranspose(tBoard board);
+tBoard engineTransform(tBoard board, tU8 transform);
+tBoard engineCanonical(tBoard board, tU8 *pTransform);
+tU8    engineTransformDir(tU8 dir, tU8 transform);
+tU8    engineRestoreDir(tU8 dir, tU8 transform);
+
+#endif
@@ -0,0 +1,77 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    engine_kernel.h
+ *
+ * Description:
+ *    The row slide kernel of the engine, shared by engine.c and the C++
+ *    host build that evaluates it at compile time (host/engine_tables.cpp).
+ *    Written in the common subset of C and C++17 constexpr: no
+ *    uninitialized locals and no calls to non constexpr functions.
+ *
+ *****************************************************************************/
+#ifndef _ENGINE_KERNEL_H_
+#define _ENGINE_KERNEL_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#if defined(__cplusplus)
+#define ENGINE_KERNEL static constexpr
+#else
+#define ENGINE_KERNEL static
+#endif
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Slides one line of four cells towards nibble 0, see engineSlideRow().
+ *
+ ****************************************************************************/
+
+ENGINE_KERNEL tU16 engineSlideKernel(tU16 row, tU8 *pMerges)
+{
+  tU16 result = 0;
+  tU8 shift = 0;
+  tU8 pending = 0;
+  tU8 tile = 0;
+  tU8 k = 0;
+
+  for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+    tile = (tU8)((row >> (k * 4)) & 0x0f);
+    if (tile == (tU8)0) {
+      continue;
+    }
+
+    if ((tile == pending) && (tile < (tU8)0x0f)) {
+      //merge with the tile waiting for a partner
+      result |= (tU16)((tile + 1) << shift);
+      shift += 4;
+      pending = 0;
+      (*pMerges)++;
+    } else {
+      if (pending != (tU8)0) {
+        result |= (tU16)(pending << shift);
+        shift += 4;
+      }
+      pending = tile;
+    }
+  }
+
+  if (pending != (tU8)0) {
+    result |= (tU16)(pending << shift);
+  }
+  return result;
+}
+
+#endif
@@ -0,0 +1,525 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    analyze.c
+ *
+ * Description:
+ *    Host tool searching one position deeply for post-game analysis.
+ *
+ *    The expectimax of ai.c is run in double precision with two additions
+ *    for deep searches: branches less likely than a cutoff probability are
+ *    evaluated instead of searched, and all threads share one lockless
+ *    transposition table. The work is split at the root: every spawn after
+ *    every possible move is a task, and a pool of threads takes the tasks
+ *    one by one from an atomic counter.
+ *
+ *    The search is repeated with 1, 2, ... threads to print a speedup
+ *    table.
+ *
+ *    Usage: analyze [board] [depth] [threads] [cutoff]
+ *
+ *    board is 16 hex digits, the exponents of the cells row by row from
+ *    the top left, e.g. 0000001002300456. Without it a position of a
+ *    depth 1 game after 500 moves is used.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "engine.h"
+#include "ai.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define MAX_THREADS  255   /* thread counts are a tU8 */
+#define MAX_TASKS    (4 * ENGINE_CELLS * 2)
+
+/* Shared table of 2^TABLE_BITS slots of 16 bytes */
+#ifndef TABLE_BITS
+#define TABLE_BITS   22
+#endif
+
+typedef unsigned long long tU64;
+
+/*
+ * A slot holds the value and a tag word xor the value, both written without
+ * a lock. The hash of the key is a bijection and its top TABLE_BITS bits
+ * pick the slot, so the other bits of the hash in the tag identify the key
+ * exactly. A slot torn by two concurrent writers fails the tag check and
+ * reads as a miss.
+ */
+typedef struct
+{
+  _Atomic tU64 check;       /* tag xor data */
+  _Atomic tU64 data;        /* value (double bits) */
+} tSlot;
+
+/* Tag word: hash << SLOT_TAG_SHIFT, depth << 1, valid bit */
+#define SLOT_TAG_SHIFT 9
+#define SLOT_VALID     1ULL
+#define SLOT_DEPTH(tag) ((tU8)((tag) >> 1))
+
+#if TABLE_BITS < SLOT_TAG_SHIFT
+#error "TABLE_BITS too small for the slot tag"
+#endif
+
+#define SLOT_HASH(key) ((key) * 0x9e3779b97f4a7c15ULL)
+
+typedef struct
+{
+  tBoard board;             /* position after the root move and a spawn */
+  double weight;            /* probability of the spawn */
+  tU8    dir;               /* root move */
+} tTask;
+
+typedef struct
+{
+  pthread_t thread;
+  tU64 nodes;
+  tU64 hits;
+  tU64 misses;
+} tThread;
+
+
+/*****************************************************************************
+ * Local variables
+ ****************************************************************************/
+static tSlot *pSlots;
+static tTask tasks[MAX_TASKS];
+static double taskValues[MAX_TASKS];
+static tU32 numTasks;
+static _Atomic tU32 nextTask;
+static tThread threads[MAX_THREADS];
+static tU8 searchDepth = 6;
+static double cutoff = 0.0001;
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static tU8 analyze(tBoard board, tU8 numThreads, double *pValues);
+static void *threadProc(void *arg);
+static double maxNode(tThread *pThread, tBoard board, tU8 depth, double prob);
+static double chanceNode(tThread *pThread, tBoard board, tU8 depth, double prob);
+static tBool tableGet(tBoard key, tU8 depth, double *pValue);
+static void tablePut(tBoard key, tU8 depth, double value);
+static tBoard parseBoard(const char *pText);
+static tBoard samplePosition(void);
+static void printBoard(tBoard board);
+static double seconds(void);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Analyzes the position with 1 to the given number of threads.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  static const char *pDirs[] = {"up", "right", "down", "left"};
+  long maxThreads = sysconf(_SC_NPROCESSORS_ONLN);
+  double values[4];
+  double single = 0;
+  double start;
+  double time;
+  tU64 nodes;
+  tU64 hits;
+  tU64 misses;
+  tBoard board;
+  tU8 best = AI_NO_MOVE;
+  tU32 t;
+  tU8 i;
+
+  if ((argc > 1) && (strcmp(argv[1], "-") != 0)) {
+    board = parseBoard(argv[1]);
+  } else {
+    board = samplePosition();
+  }
+  if (argc > 2) {
+    searchDepth = (tU8)strtoul(argv[2], NULL, 0);
+  }
+  if (argc > 3) {
+    maxThreads = strtol(argv[3], NULL, 0);
+  }
+  if (argc > 4) {
+    cutoff = strtod(argv[4], NULL);
+  }
+  if (maxThreads < 1) {
+    maxThreads = 1;
+  }
+  if (maxThreads > MAX_THREADS) {
+    maxThreads = MAX_THREADS;
+  }
+  if (searchDepth < 1) {
+    searchDepth = 1;
+  }
+
+  pSlots = malloc(sizeof(tSlot) << TABLE_BITS);
+  if (pSlots == NULL) {
+    fprintf(stderr, "out of memory for the transposition table\n");
+    return 1;
+  }
+
+  printBoard(board);
+  printf("depth %u, cutoff %g, table %u MB\n\n", searchDepth, cutoff,
+         (unsigned)((sizeof(tSlot) << TABLE_BITS) >> 20));
+  printf("  threads   time s    Mnodes  Mnodes/s  speedup  hits %%  best\n");
+
+  for (t = 1; t <= (tU32)maxThreads; ++t) {
+    memset(pSlots, 0, sizeof(tSlot) << TABLE_BITS);
+    memset(threads, 0, sizeof(threads));
+
+    start = seconds();
+    best = analyze(board, (tU8)t, values);
+    time = seconds() - start;
+    if (t == (tU32)1) {
+      single = time;
+    }
+
+    nodes = 0;
+    hits = 0;
+    misses = 0;
+    for (i = 0; i < t; ++i) {
+      nodes += threads[i].nodes;
+      hits += threads[i].hits;
+      misses += threads[i].misses;
+    }
+    printf("  %7u %8.3f %9.2f %9.2f %8.2f %7.1f  %s\n", t, time, nodes / 1e6,
+           nodes / 1e6 / time, single / time,
+           ((hits + misses) != 0) ? (100.0 * hits / (hits + misses)) : 0.0,
+           (best != (tU8)AI_NO_MOVE) ? pDirs[best] : "none");
+  }
+
+  printf("\n");
+  for (i = 0; i < (tU8)4; ++i) {
+    if (values[i] > (double)AI_LOST_SCORE) {
+      printf("  %-5s %12.1f%s\n", pDirs[i], values[i], (i == best) ? "  <=" : "");
+    } else {
+      printf("  %-5s %12s\n", pDirs[i], "-");
+    }
+  }
+
+  free(pSlots);
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Searches the position with the given number of threads.
+ *
+ * Params:
+ *    [in]  board      - The position.
+ *    [in]  numThreads - Size of the thread pool.
+ *    [out] pValues    - Expected value of each move, AI_LOST_SCORE if the
+ *                       move is not possible.
+ *
+ * Return: the best move, AI_NO_MOVE if there is none
+ *
+ ****************************************************************************/
+
+static tU8 analyze(tBoard board, tU8 numThreads, double *pValues)
+{
+  tBoard next;
+  tU16 empty;
+  tU8 count;
+  tU8 merges;
+  tU8 dir;
+  tU8 cell;
+  tU8 best = AI_NO_MOVE;
+  tU32 i;
+
+  numTasks = 0;
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    pValues[dir] = AI_LOST_SCORE;
+    next = engineMove(board, dir, &merges);
+    if (next == board) {
+      continue;
+    }
+    pValues[dir] = 0;
+    empty = engineEmptyMask(next);
+    count = enginePopCount(empty);
+    for (cell = 0; cell < (tU8)ENGINE_CELLS; ++cell) {
+      if ((empty & (1 << cell)) != 0) {
+        tasks[numTasks].board = next | ((tBoard)1 << (cell * 4));
+        tasks[numTasks].weight = 0.9 / count;
+        tasks[numTasks].dir = dir;
+        numTasks++;
+        tasks[numTasks].board = next | ((tBoard)2 << (cell * 4));
+        tasks[numTasks].weight = 0.1 / count;
+        tasks[numTasks].dir = dir;
+        numTasks++;
+      }
+    }
+  }
+
+  atomic_store(&nextTask, 0);
+  for (i = 0; i < numThreads; ++i) {
+    pthread_create(&threads[i].thread, NULL, threadProc, &threads[i]);
+  }
+  for (i = 0; i < numThreads; ++i) {
+    pthread_join(threads[i].thread, NULL);
+  }
+
+  for (i = 0; i < numTasks; ++i) {
+    pValues[tasks[i].dir] += tasks[i].weight * taskValues[i];
+  }
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    if ((pValues[dir] > (double)AI_LOST_SCORE) &&
+        ((best == (tU8)AI_NO_MOVE) || (pValues[dir] > pValues[best]))) {
+      best = dir;
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Pool thread, searches root tasks until none are left.
+ *
+ ****************************************************************************/
+
+static void *threadProc(void *arg)
+{
+  tThread *pThread = (tThread *)arg;
+  tU32 task;
+
+  for (;;) {
+    task = atomic_fetch_add(&nextTask, 1);
+    if (task >= numTasks) {
+      break;
+    }
+    taskValues[task] = maxNode(pThread, tasks[task].board, (tU8)(searchDepth - 1),
+                               tasks[task].weight);
+  }
+  return NULL;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Value of the best own move. Positions at the horizon or reached with
+ *    a probability below the cutoff are evaluated.
+ *
+ ****************************************************************************/
+
+static double maxNode(tThread *pThread, tBoard board, tU8 depth, double prob)
+{
+  double best = AI_LOST_SCORE;
+  double value;
+  tBoard next;
+  tU8 merges;
+  tU8 dir;
+
+  pThread->nodes++;
+  if ((depth == (tU8)0) || (prob < cutoff)) {
+    return aiEvaluate(board);
+  }
+
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    next = engineMove(board, dir, &merges);
+    if (next != board) {
+      value = chanceNode(pThread, next, (tU8)(depth - 1), prob);
+      if (value > best) {
+        best = value;
+      }
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Expected value over all spawns, cached by canonical board.
+ *
+ ****************************************************************************/
+
+static double chanceNode(tThread *pThread, tBoard board, tU8 depth, double prob)
+{
+  tU16 empty = engineEmptyMask(board);
+  tU8 count = enginePopCount(empty);
+  tBoard key = engineCanonical(board, NULL);
+  double sum = 0;
+  double value;
+  tU8 cell;
+
+  if (count == (tU8)0) {
+    return maxNode(pThread, board, depth, prob);
+  }
+  if (tableGet(key, depth, &value) == TRUE) {
+    pThread->hits++;
+    return value;
+  }
+  pThread->misses++;
+
+  for (cell = 0; cell < (tU8)ENGINE_CELLS; ++cell) {
+    if ((empty & (1 << cell)) != 0) {
+      sum += 0.9 * maxNode(pThread, board | ((tBoard)1 << (cell * 4)), depth,
+                           prob * 0.9 / count);
+      sum += 0.1 * maxNode(pThread, board | ((tBoard)2 << (cell * 4)), depth,
+                           prob * 0.1 / count);
+    }
+  }
+  value = sum / count;
+  tablePut(key, depth, value);
+  return value;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Looks a chance node up in the shared table. Entries searched deeper
+ *    than needed are used as well.
+ *
+ ****************************************************************************/
+
+static tBool tableGet(tBoard key, tU8 depth, double *pValue)
+{
+  tU64 hash = SLOT_HASH(key);
+  tSlot *pSlot = &pSlots[hash >> (64 - TABLE_BITS)];
+  tU64 data = atomic_load_explicit(&pSlot->data, memory_order_relaxed);
+  tU64 check = atomic_load_explicit(&pSlot->check, memory_order_relaxed);
+  tU64 tag = check ^ data;
+
+  if (((tag >> SLOT_TAG_SHIFT) != ((hash << SLOT_TAG_SHIFT) >> SLOT_TAG_SHIFT)) ||
+      ((tag & SLOT_VALID) == 0) || (SLOT_DEPTH(tag) < depth)) {
+    return FALSE;
+  }
+  memcpy(pValue, &data, sizeof(*pValue));
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Stores a chance node in the shared table, always replacing the slot.
+ *
+ ****************************************************************************/
+
+static void tablePut(tBoard key, tU8 depth, double value)
+{
+  tU64 hash = SLOT_HASH(key);
+  tSlot *pSlot = &pSlots[hash >> (64 - TABLE_BITS)];
+  tU64 tag = (hash << SLOT_TAG_SHIFT) | ((tU64)depth << 1) | SLOT_VALID;
+  tU64 data;
+
+  memcpy(&data, &value, sizeof(data));
+  atomic_store_explicit(&pSlot->check, tag ^ data, memory_order_relaxed);
+  atomic_store_explicit(&pSlot->data, data, memory_order_relaxed);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reads a board given as 16 hex exponents, row by row.
+ *
+ ****************************************************************************/
+
+static tBoard parseBoard(const char *pText)
+{
+  tBoard board = 0;
+  tU8 i;
+  char c;
+
+  for (i = 0; i < (tU8)ENGINE_CELLS; ++i) {
+    c = pText[i];
+    if ((c >= '0') && (c <= '9')) {
+      board |= (tBoard)(c - '0') << (i * 4);
+    } else if ((c >= 'a') && (c <= 'f')) {
+      board |= (tBoard)(c - 'a' + 10) << (i * 4);
+    } else if ((c >= 'A') && (c <= 'F')) {
+      board |= (tBoard)(c - 'A' + 10) << (i * 4);
+    } else {
+      fprintf(stderr, "board must be 16 hex digits\n");
+      exit(1);
+    }
+  }
+  return board;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays 500 moves of a depth 1 game to get a typical position.
+ *
+ ****************************************************************************/
+
+static tBoard samplePosition(void)
+{
+  tAiSearch search;
+  tGame game;
+  tU16 n;
+  tU8 dir;
+
+  memset(&search, 0, sizeof(search));
+  search.depth = 1;
+  engineNewGame(&game, 1);
+  for (n = 0; n < 500; ++n) {
+    dir = aiBestMove(&search, game.board);
+    if (dir == (tU8)AI_NO_MOVE) {
+      break;
+    }
+    engineStep(&game, dir);
+  }
+  return game.board;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Prints the tile values of a board.
+ *
+ ****************************************************************************/
+
+static void printBoard(tBoard board)
+{
+  tU8 y;
+  tU8 x;
+  tU8 tile;
+
+  for (y = 0; y < (tU8)ENGINE_SIZE; ++y) {
+    printf(" ");
+    for (x = 0; x < (tU8)ENGINE_SIZE; ++x) {
+      tile = engineGetCell(board, y, x);
+      if (tile == 0) {
+        printf("     .");
+      } else {
+        printf(" %5u", 1 << tile);
+      }
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Wall clock time for the speedup table.
+ *
+ ****************************************************************************/
+
+static double seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
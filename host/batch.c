@@ -0,0 +1,365 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    batch.c
+ *
+ * Description:
+ *    Moves arrays of boards in one direction. On x86 the boards are
+ *    unpacked to one byte per cell, one board per 128-bit lane, and the
+ *    four rows of a board are slid at once with byte shuffles and
+ *    compares:
+ *
+ *    1. A shuffle turns the move into a left slide (rows are mirrored for
+ *       right, the board is transposed for up and down).
+ *    2. Tiles are compacted to the left by an odd-even transposition of
+ *       each row, swapping a pair if its left cell is empty.
+ *    3. Equal neighbours are paired from the left, the left tile of a pair
+ *       is raised and the right one cleared; 15 never merges, as in
+ *       engineSlideRow().
+ *    4. The holes left by the merges are compacted, the inverse shuffle
+ *       of step 1 is applied and the board is packed again.
+ *
+ *    The SSSE3 kernel does one board per step, the AVX2 kernel two. The
+ *    kernel is selected at run time, elsewhere the scalar engine is used.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <string.h>
+#include "batch.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define BATCH_X86
+#include <immintrin.h>
+#endif
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static void moveScalar(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir);
+#if defined(BATCH_X86)
+static void moveSsse3(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir);
+static void moveAvx2(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir);
+#endif
+
+
+/*****************************************************************************
+ * Local variables
+ ****************************************************************************/
+#if defined(BATCH_X86)
+/*
+ * Cell shuffles turning each direction into a left slide, and back.
+ * Entry i holds the source cell of cell i.
+ */
+static const tU8 toLeft[4][16] = {
+  {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15},  /* up: transpose */
+  {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},  /* right: mirror */
+  {12, 8, 4, 0, 13, 9, 5, 1, 14, 10, 6, 2, 15, 11, 7, 3},  /* down */
+  {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}   /* left */
+};
+static const tU8 fromLeft[4][16] = {
+  {0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15},
+  {3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12},
+  {3, 7, 11, 15, 2, 6, 10, 14, 1, 5, 9, 13, 0, 4, 8, 12},
+  {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15}
+};
+
+#endif
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves count boards in direction dir with the fastest kernel of this
+ *    machine. pIn and pOut may be the same array.
+ *
+ ****************************************************************************/
+
+void batchMove(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir)
+{
+  batchMoveWith(batchKernel(), pIn, pOut, count, dir);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves count boards with the given kernel, which must be supported.
+ *
+ ****************************************************************************/
+
+void batchMoveWith(tU8 kernel, const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir)
+{
+  switch (kernel) {
+#if defined(BATCH_X86)
+    case BATCH_AVX2:
+      moveAvx2(pIn, pOut, count, dir);
+      break;
+    case BATCH_SSSE3:
+      moveSsse3(pIn, pOut, count, dir);
+      break;
+#endif
+    default:
+      moveScalar(pIn, pOut, count, dir);
+      break;
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Finds the fastest kernel the processor supports.
+ *
+ ****************************************************************************/
+
+tU8 batchKernel(void)
+{
+#if defined(BATCH_X86)
+  if (__builtin_cpu_supports("avx2")) {
+    return BATCH_AVX2;
+  }
+  if (__builtin_cpu_supports("ssse3")) {
+    return BATCH_SSSE3;
+  }
+#endif
+  return BATCH_SCALAR;
+}
+
+const char *batchKernelName(tU8 kernel)
+{
+  switch (kernel) {
+    case BATCH_AVX2:  return "avx2";
+    case BATCH_SSSE3: return "ssse3";
+    default:          return "scalar";
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reference kernel, one engineMove() per board.
+ *
+ ****************************************************************************/
+
+static void moveScalar(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir)
+{
+  tU8 merges;
+  tU32 i;
+
+  for (i = 0; i < count; ++i) {
+    pOut[i] = engineMove(pIn[i], dir, &merges);
+  }
+}
+
+#if defined(BATCH_X86)
+
+/*
+ * The slide is written once with the operation names below, which each
+ * kernel defines for its vector width. It only uses byte compares and
+ * 16/32-bit shifts, a row of a board being one 32-bit element, so it does
+ * not compete with the shuffles for the one shuffle port of the processor.
+ * Within a row, SRL32(x, 8) moves every cell to its left neighbour and
+ * SLL32(x, 8) to its right neighbour. Temporaries z, m and eq and the
+ * constants zero, low, cell1 and fifteen must be in scope.
+ *
+ * A compaction step changes a pair if its left cell is empty and its
+ * right one is not, the pair then becomes (right, 0). For the pairs
+ * (0, 1) and (2, 3) that is a 16-bit shift with a 16-bit compare mask.
+ */
+#define COMPACT_EVEN(v) \
+  do { \
+    m = ANDNOT(CMPEQ16(v, zero), CMPEQ16(AND(v, low), zero)); \
+    v = BLEND(v, SRL16(v, 8), m); \
+  } while (0)
+
+#define COMPACT_ODD(v) \
+  do { \
+    z = CMPEQ(v, zero); \
+    m = AND(ANDNOT(SRL32(z, 8), z), cell1); \
+    m = OR(m, SLL32(m, 8)); \
+    v = BLEND(v, AND(SRL32(v, 8), cell1), m); \
+  } while (0)
+
+#define MERGE(v) \
+  do { \
+    eq = AND(CMPEQ(v, SRL32(v, 8)), AND(CMPGT(v, zero), CMPGT(fifteen, v))); \
+    m = ANDNOT(SLL32(eq, 8), eq); \
+    m = ANDNOT(SLL32(m, 8), eq); \
+    v = SUB(v, m); \
+    v = ANDNOT(SLL32(m, 8), v); \
+  } while (0)
+
+/*
+ * Slides every row of a and b to the left, the two independent chains
+ * interleaved to keep the execution units busy. Compacting takes four
+ * phases of the transposition: pairs (0, 1) and (2, 3) are the 16-bit
+ * halves of a row, pair (1, 2) the middle cells. After the merges the
+ * holes are at most two cells apart and two phases close them.
+ */
+#define SLIDE_LEFT2(a, b) \
+  do { \
+    COMPACT_EVEN(a); COMPACT_EVEN(b); \
+    COMPACT_ODD(a);  COMPACT_ODD(b);  \
+    COMPACT_EVEN(a); COMPACT_EVEN(b); \
+    COMPACT_ODD(a);  COMPACT_ODD(b);  \
+    MERGE(a);        MERGE(b);        \
+    COMPACT_ODD(a);  COMPACT_ODD(b);  \
+    COMPACT_EVEN(a); COMPACT_EVEN(b); \
+  } while (0)
+
+#define AND    _mm_and_si128
+#define ANDNOT _mm_andnot_si128
+#define OR     _mm_or_si128
+#define CMPEQ  _mm_cmpeq_epi8
+#define CMPEQ16 _mm_cmpeq_epi16
+#define CMPGT  _mm_cmpgt_epi8
+#define SUB    _mm_sub_epi8
+#define SRL16  _mm_srli_epi16
+#define SLL32  _mm_slli_epi32
+#define SRL32  _mm_srli_epi32
+#define BLEND(a, b, mask) _mm_or_si128(_mm_andnot_si128(mask, a), _mm_and_si128(mask, b))
+
+/*****************************************************************************
+ *
+ * Description:
+ *    SSSE3 kernel, one board per 128-bit vector, two per step.
+ *
+ ****************************************************************************/
+
+__attribute__((target("ssse3")))
+static void moveSsse3(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir)
+{
+  const __m128i toLeftCtl   = _mm_loadu_si128((const __m128i *)toLeft[dir]);
+  const __m128i fromLeftCtl = _mm_loadu_si128((const __m128i *)fromLeft[dir]);
+  const __m128i nibbles     = _mm_set1_epi8(0x0f);
+  const __m128i pack        = _mm_set1_epi16(0x1001);
+  const __m128i zero        = _mm_setzero_si128();
+  const __m128i fifteen     = _mm_set1_epi8(15);
+  const __m128i low         = _mm_set1_epi32(0x00ff00ff);
+  const __m128i cell1       = _mm_set1_epi32(0x0000ff00);
+  __m128i packed;
+  __m128i v0;
+  __m128i v1;
+  __m128i z;
+  __m128i m;
+  __m128i eq;
+  tU32 i;
+
+  for (i = 0; i < count; i += 2) {
+    //an odd count repeats the last board
+    packed = _mm_loadl_epi64((const __m128i *)&pIn[i]);
+    v0 = _mm_unpacklo_epi8(_mm_and_si128(packed, nibbles),
+                           _mm_and_si128(_mm_srli_epi16(packed, 4), nibbles));
+    packed = _mm_loadl_epi64((const __m128i *)&pIn[((i + 1) < count) ? (i + 1) : i]);
+    v1 = _mm_unpacklo_epi8(_mm_and_si128(packed, nibbles),
+                           _mm_and_si128(_mm_srli_epi16(packed, 4), nibbles));
+    v0 = _mm_shuffle_epi8(v0, toLeftCtl);
+    v1 = _mm_shuffle_epi8(v1, toLeftCtl);
+
+    SLIDE_LEFT2(v0, v1);
+
+    v0 = _mm_shuffle_epi8(v0, fromLeftCtl);
+    v1 = _mm_shuffle_epi8(v1, fromLeftCtl);
+    v0 = _mm_packus_epi16(_mm_maddubs_epi16(v0, pack), _mm_maddubs_epi16(v1, pack));
+    _mm_storel_epi64((__m128i *)&pOut[i], v0);
+    if ((i + 1) < count) {
+      _mm_storel_epi64((__m128i *)&pOut[i + 1], _mm_unpackhi_epi64(v0, v0));
+    }
+  }
+}
+
+#undef AND
+#undef ANDNOT
+#undef OR
+#undef CMPEQ
+#undef CMPEQ16
+#undef CMPGT
+#undef SUB
+#undef SRL16
+#undef SLL32
+#undef SRL32
+#undef BLEND
+
+#define AND    _mm256_and_si256
+#define ANDNOT _mm256_andnot_si256
+#define OR     _mm256_or_si256
+#define CMPEQ  _mm256_cmpeq_epi8
+#define CMPEQ16 _mm256_cmpeq_epi16
+#define CMPGT  _mm256_cmpgt_epi8
+#define SUB    _mm256_sub_epi8
+#define SRL16  _mm256_srli_epi16
+#define SLL32  _mm256_slli_epi32
+#define SRL32  _mm256_srli_epi32
+#define BLEND  _mm256_blendv_epi8
+
+/* Broadcasts a 16 byte table to both lanes */
+#define LOAD2(table) _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i *)(table)))
+
+/*****************************************************************************
+ *
+ * Description:
+ *    AVX2 kernel, two boards per 256-bit vector, four per step.
+ *
+ ****************************************************************************/
+
+__attribute__((target("avx2")))
+static void moveAvx2(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir)
+{
+  const __m256i toLeftCtl   = LOAD2(toLeft[dir]);
+  const __m256i fromLeftCtl = LOAD2(fromLeft[dir]);
+  const __m256i nibbles     = _mm256_set1_epi8(0x0f);
+  const __m256i pack        = _mm256_set1_epi16(0x1001);
+  const __m256i zero        = _mm256_setzero_si256();
+  const __m256i fifteen     = _mm256_set1_epi8(15);
+  const __m256i low         = _mm256_set1_epi32(0x00ff00ff);
+  const __m256i cell1       = _mm256_set1_epi32(0x0000ff00);
+  __m256i packed;
+  __m256i v0;
+  __m256i v1;
+  __m256i z;
+  __m256i m;
+  __m256i eq;
+  tU32 i;
+
+  for (i = 0; (i + 4) <= count; i += 4) {
+    //boards i, i+2 in the low lanes, i+1, i+3 in the high lanes
+    packed = _mm256_loadu_si256((const __m256i *)&pIn[i]);
+    packed = _mm256_permute4x64_epi64(packed, 0xd8);
+    v0 = _mm256_unpacklo_epi8(_mm256_and_si256(packed, nibbles),
+                              _mm256_and_si256(_mm256_srli_epi16(packed, 4), nibbles));
+    v1 = _mm256_unpackhi_epi8(_mm256_and_si256(packed, nibbles),
+                              _mm256_and_si256(_mm256_srli_epi16(packed, 4), nibbles));
+    v0 = _mm256_shuffle_epi8(v0, toLeftCtl);
+    v1 = _mm256_shuffle_epi8(v1, toLeftCtl);
+
+    SLIDE_LEFT2(v0, v1);
+
+    v0 = _mm256_shuffle_epi8(v0, fromLeftCtl);
+    v1 = _mm256_shuffle_epi8(v1, fromLeftCtl);
+    v0 = _mm256_packus_epi16(_mm256_maddubs_epi16(v0, pack), _mm256_maddubs_epi16(v1, pack));
+    v0 = _mm256_permute4x64_epi64(v0, 0xd8);
+    _mm256_storeu_si256((__m256i *)&pOut[i], v0);
+  }
+  if (i < count) {
+    moveSsse3(&pIn[i], &pOut[i], count - i, dir);
+  }
+}
+
+#undef AND
+#undef ANDNOT
+#undef OR
+#undef CMPEQ
+#undef CMPEQ16
+#undef CMPGT
+#undef SUB
+#undef SRL16
+#undef SLL32
+#undef SRL32
+#undef BLEND
+
+#endif
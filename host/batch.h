@@ -0,0 +1,36 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    batch.h
+ *
+ * Description:
+ *    Expose the batch move kernel of the host tools, moving many boards in
+ *    the same direction at once.
+ *
+ *****************************************************************************/
+#ifndef _BATCH_H_
+#define _BATCH_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define BATCH_SCALAR 0
+#define BATCH_SSSE3  1
+#define BATCH_AVX2   2
+
+
+void  batchMove(const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir);
+void  batchMoveWith(tU8 kernel, const tBoard *pIn, tBoard *pOut, tU32 count, tU8 dir);
+tU8   batchKernel(void);
+const char *batchKernelName(tU8 kernel);
+
+#endif
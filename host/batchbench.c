@@ -0,0 +1,129 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    batchbench.c
+ *
+ * Description:
+ *    Host tool measuring the batch move kernels against the scalar table
+ *    engine. Every kernel is checked against the scalar results first.
+ *
+ *    Usage: batchbench [boards] [rounds]
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "batch.h"
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static double seconds(void);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves random mid-game boards in all directions with every kernel the
+ *    processor supports and prints boards per second.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  tU32 boards = 1 << 20;
+  tU32 rounds = 20;
+  tBoard *pIn;
+  tBoard *pOut;
+  tBoard *pRef;
+  double scalar = 0;
+  double start;
+  double rate;
+  tRng rng;
+  tU32 i;
+  tU32 r;
+  tU8 kernel;
+  tU8 dir;
+  tU8 k;
+
+  if (argc > 1) {
+    boards = (tU32)strtoul(argv[1], NULL, 0);
+  }
+  if (argc > 2) {
+    rounds = (tU32)strtoul(argv[2], NULL, 0);
+  }
+
+  pIn = malloc(boards * sizeof(tBoard));
+  pOut = malloc(boards * sizeof(tBoard));
+  pRef = malloc(boards * sizeof(tBoard));
+  if ((pIn == NULL) || (pOut == NULL) || (pRef == NULL)) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  //a third of the cells empty, tiles up to 2048
+  rngSeed(&rng, 1);
+  for (i = 0; i < boards; ++i) {
+    pIn[i] = 0;
+    for (k = 0; k < (tU8)ENGINE_CELLS; ++k) {
+      r = rngNext(&rng) % 18;
+      pIn[i] |= (tBoard)((r < 6) ? 0 : (r - 6)) << (k * 4);
+    }
+  }
+
+  printf("%u boards, %u rounds of 4 directions\n", boards, rounds);
+  printf("  kernel   Mboards/s  speedup\n");
+  for (kernel = BATCH_SCALAR; kernel <= batchKernel(); ++kernel) {
+    for (dir = 0; dir < (tU8)4; ++dir) {
+      batchMoveWith(BATCH_SCALAR, pIn, pRef, boards, dir);
+      batchMoveWith(kernel, pIn, pOut, boards, dir);
+      for (i = 0; i < boards; ++i) {
+        if (pOut[i] != pRef[i]) {
+          fprintf(stderr, "%s kernel differs in direction %u\n",
+                  batchKernelName(kernel), dir);
+          return 1;
+        }
+      }
+    }
+
+    start = seconds();
+    for (r = 0; r < rounds; ++r) {
+      for (dir = 0; dir < (tU8)4; ++dir) {
+        batchMoveWith(kernel, pIn, pOut, boards, dir);
+      }
+    }
+    rate = (4.0 * rounds * boards) / (seconds() - start);
+    if (kernel == (tU8)BATCH_SCALAR) {
+      scalar = rate;
+    }
+    printf("  %-8s %10.1f %8.2f\n", batchKernelName(kernel), rate / 1e6, rate / scalar);
+  }
+
+  free(pIn);
+  free(pOut);
+  free(pRef);
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Wall clock time for the rates.
+ *
+ ****************************************************************************/
+
+static double seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
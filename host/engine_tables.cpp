@@ -0,0 +1,256 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    engine_tables.cpp
+ *
+ * Description:
+ *    Row tables of the host engine (ENGINE_TABLES_FULL) as constexpr arrays.
+ *    The compiler evaluates the shared kernels of engine_kernel.h and
+ *    ai_kernel.h for every row, so the host tools neither run gentables
+ *    nor fill tables at startup. The static_asserts check the tables
+ *    against an independent implementation of the engineSlideRow() rules
+ *    (compact, merge, compact). These are the engine's rules, not the
+ *    merge rules of the first moveGrid() of the game.
+ *    The firmware keeps the tables generated by host/gentables.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+extern "C" {
+#include "engine.h"
+#include "ai.h"
+}
+#include "engine_kernel.h"
+#include "ai_kernel.h"
+
+#if !defined(ENGINE_TABLES_FULL)
+#error "engine_tables.cpp builds the ENGINE_TABLES_FULL tables"
+#endif
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+/* Expands f(row) for 4^n consecutive rows starting at row */
+#define ROWS4(f, row)     f((row)), f((row) + 1), f((row) + 2), f((row) + 3)
+#define ROWS16(f, row)    ROWS4(f, (row)), ROWS4(f, (row) + 4), \
+                          ROWS4(f, (row) + 8), ROWS4(f, (row) + 12)
+#define ROWS256(f, row)   ROWS16(f, (row)), ROWS16(f, (row) + 16), \
+                          ROWS16(f, (row) + 32), ROWS16(f, (row) + 48), \
+                          ROWS16(f, (row) + 64), ROWS16(f, (row) + 80), \
+                          ROWS16(f, (row) + 96), ROWS16(f, (row) + 112), \
+                          ROWS16(f, (row) + 128), ROWS16(f, (row) + 144), \
+                          ROWS16(f, (row) + 160), ROWS16(f, (row) + 176), \
+                          ROWS16(f, (row) + 192), ROWS16(f, (row) + 208), \
+                          ROWS16(f, (row) + 224), ROWS16(f, (row) + 240)
+#define ROWS4096(f, row)  ROWS256(f, (row)), ROWS256(f, (row) + 256), \
+                          ROWS256(f, (row) + 512), ROWS256(f, (row) + 768), \
+                          ROWS256(f, (row) + 1024), ROWS256(f, (row) + 1280), \
+                          ROWS256(f, (row) + 1536), ROWS256(f, (row) + 1792), \
+                          ROWS256(f, (row) + 2048), ROWS256(f, (row) + 2304), \
+                          ROWS256(f, (row) + 2560), ROWS256(f, (row) + 2816), \
+                          ROWS256(f, (row) + 3072), ROWS256(f, (row) + 3328), \
+                          ROWS256(f, (row) + 3584), ROWS256(f, (row) + 3840)
+#define ROWS65536(f)      ROWS4096(f, 0), ROWS4096(f, 4096), \
+                          ROWS4096(f, 8192), ROWS4096(f, 12288), \
+                          ROWS4096(f, 16384), ROWS4096(f, 20480), \
+                          ROWS4096(f, 24576), ROWS4096(f, 28672), \
+                          ROWS4096(f, 32768), ROWS4096(f, 36864), \
+                          ROWS4096(f, 40960), ROWS4096(f, 45056), \
+                          ROWS4096(f, 49152), ROWS4096(f, 53248), \
+                          ROWS4096(f, 57344), ROWS4096(f, 61440)
+
+/* Packs four exponents, a is nibble 0 */
+#define ROW(a, b, c, d) ((tU16)((a) | ((b) << 4) | ((c) << 8) | ((d) << 12)))
+
+
+/*
+ * constexpr functions have to be defined before the tables use them, hence
+ * no local prototypes and the tables at the end of the file.
+ */
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reverses the order of the four nibbles of a line.
+ *
+ ****************************************************************************/
+
+static constexpr tU16 reverseRow(tU16 row)
+{
+  return (tU16)((row >> 12) | ((row >> 4) & 0x00f0) |
+                ((row << 4) & 0x0f00) | (row << 12));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Table entries of one row.
+ *
+ ****************************************************************************/
+
+static constexpr tU16 rowLeft(tU32 row)
+{
+  tU8 merges = 0;
+
+  return engineSlideKernel((tU16)row, &merges);
+}
+
+static constexpr tU16 rowRight(tU32 row)
+{
+  tU8 merges = 0;
+
+  return reverseRow(engineSlideKernel(reverseRow((tU16)row), &merges));
+}
+
+static constexpr tS32 rowScore(tU32 row)
+{
+  return aiLineKernel((tU16)row);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Left move of one row by the engineSlideRow() rules: compact the
+ *    tiles, merge equal neighbours from the left, compact again. Written
+ *    independently of engineSlideKernel() to check it.
+ *
+ ****************************************************************************/
+
+static constexpr tU16 referenceRow(tU16 row)
+{
+  tU8 cell[ENGINE_SIZE] = {0};
+  tU8 tile = 0;
+  tU8 n = 0;
+  tU8 k = 0;
+  tU16 result = 0;
+
+  //compact
+  for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+    tile = (tU8)((row >> (k * 4)) & 0x0f);
+    if (tile != (tU8)0) {
+      cell[n++] = tile;
+    }
+  }
+
+  //merge, 15 is the largest exponent
+  for (k = 0; k + 1 < n; ++k) {
+    if ((cell[k] == cell[k + 1]) && (cell[k] < (tU8)0x0f)) {
+      cell[k]++;
+      cell[k + 1] = 0;
+      ++k;
+    }
+  }
+
+  //compact again
+  n = 0;
+  for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+    if (cell[k] != (tU8)0) {
+      result |= (tU16)(cell[k] << (n * 4));
+      n++;
+    }
+  }
+  return result;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Merges of the left move of one row, from the tile count it loses.
+ *
+ ****************************************************************************/
+
+static constexpr tU8 rowMerges(tU16 row)
+{
+  tU8 before = 0;
+  tU8 after = 0;
+  tU16 moved = referenceRow(row);
+  tU8 k = 0;
+
+  for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+    before += (((row >> (k * 4)) & 0x0f) != 0) ? 1 : 0;
+    after += (((moved >> (k * 4)) & 0x0f) != 0) ? 1 : 0;
+  }
+  return (tU8)(before - after);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Compares count entries of both slide tables and the merge count of
+ *    the kernel with the reference move. Called in slices to stay below
+ *    the operation limit of constexpr evaluation.
+ *
+ ****************************************************************************/
+
+static constexpr tBool checkTables(tU32 first, tU32 count)
+{
+  tU32 row = 0;
+  tU8 merges = 0;
+
+  for (row = first; row < first + count; ++row) {
+    if (engineRowLeft[row] != referenceRow((tU16)row)) {
+      return FALSE;
+    }
+    if (engineRowRight[row] !=
+        reverseRow(referenceRow(reverseRow((tU16)row)))) {
+      return FALSE;
+    }
+    merges = 0;
+    engineSlideKernel((tU16)row, &merges);
+    if (merges != rowMerges((tU16)row)) {
+      return FALSE;
+    }
+  }
+  return TRUE;
+}
+
+
+/******************************************************************************
+ * Public variables
+ *****************************************************************************/
+constexpr tU16 engineRowLeft[ENGINE_ROW_ENTRIES] = { ROWS65536(rowLeft) };
+constexpr tU16 engineRowRight[ENGINE_ROW_ENTRIES] = { ROWS65536(rowRight) };
+constexpr tS32 aiRowScore[ENGINE_ROW_ENTRIES] = { ROWS65536(rowScore) };
+
+
+/******************************************************************************
+ * Compile time checks
+ *****************************************************************************/
+//one merge per tile, merged tiles do not merge again
+static_assert(engineRowLeft[ROW(1, 1, 1, 1)] == ROW(2, 2, 0, 0), "2 2 2 2 left");
+static_assert(engineRowLeft[ROW(1, 1, 2, 0)] == ROW(2, 2, 0, 0), "2 2 4 . left");
+static_assert(engineRowLeft[ROW(2, 1, 1, 0)] == ROW(2, 2, 0, 0), "4 2 2 . left");
+static_assert(engineRowRight[ROW(1, 1, 1, 0)] == ROW(0, 0, 1, 2), "2 2 2 . right");
+//tiles slide over gaps before merging
+static_assert(engineRowLeft[ROW(0, 1, 0, 1)] == ROW(2, 0, 0, 0), ". 2 . 2 left");
+static_assert(engineRowRight[ROW(3, 0, 0, 0)] == ROW(0, 0, 0, 3), "8 . . . right");
+static_assert(engineRowLeft[ROW(1, 2, 3, 4)] == ROW(1, 2, 3, 4), "full row stays");
+//32768 is the largest tile a nibble holds
+static_assert(engineRowLeft[ROW(15, 15, 0, 0)] == ROW(15, 15, 0, 0), "no merge past 15");
+static_assert(engineRowLeft[ROW(14, 14, 0, 0)] == ROW(15, 0, 0, 0), "16384 merge");
+//the score table is the line heuristic
+static_assert(aiRowScore[0] == (AI_BASE_SCORE / 8) + (4 * AI_EMPTY_WEIGHT), "empty row score");
+//every row against the reference move
+static_assert(checkTables(0, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(4096, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(8192, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(12288, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(16384, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(20480, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(24576, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(28672, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(32768, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(36864, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(40960, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(45056, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(49152, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(53248, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(57344, 4096), "row tables differ from the engineSlideRow() rules");
+static_assert(checkTables(61440, 4096), "row tables differ from the engineSlideRow() rules");
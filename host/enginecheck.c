@@ -0,0 +1,147 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    enginecheck.c
+ *
+ * Description:
+ *    Host tool checking the board summary of the engine against moving
+ *    the board in every direction. Half of the boards are full and built
+ *    from the largest tiles only, where 15s lie next to each other.
+ *
+ *    Usage: enginecheck [boards]
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include "engine.h"
+#include "rng.h"
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static tBool summaryRight(const tGame *pGame);
+static tBool canMove(tBoard board);
+static tBoard randomBoard(tRng *pRng, tBool full);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Compares engineGameOver() and maxTile of boards put into a game and of
+ *    the game after one more step with the brute force results.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  tU32 boards = 1000000;
+  tU32 errors = 0;
+  tGame game;
+  tBoard board;
+  tRng rng;
+  tU32 i;
+  tU8 dir;
+
+  if (argc > 1) {
+    boards = (tU32)strtoul(argv[1], NULL, 0);
+  }
+
+  rngSeed(&rng, 1);
+  engineNewGame(&game, 1);
+  for (i = 0; i < boards; ++i) {
+    board = randomBoard(&rng, (tBool)(i & 1));
+    engineSetBoard(&game, board);
+    if (summaryRight(&game) == (tBool)FALSE) {
+      if (errors < 10) {
+        printf("summary wrong for %016llx\n", (unsigned long long)board);
+      }
+      errors++;
+    }
+
+    //the summary kept up to date by a step
+    for (dir = 0; dir < (tU8)4; ++dir) {
+      engineSetBoard(&game, board);
+      if (engineStep(&game, dir) == (tU16)ENGINE_NO_MOVE) {
+        continue;
+      }
+      if (summaryRight(&game) == (tBool)FALSE) {
+        if (errors < 10) {
+          printf("summary wrong after %016llx dir %u\n", (unsigned long long)board, dir);
+        }
+        errors++;
+      }
+      break;
+    }
+  }
+
+  printf("%u boards, %u errors\n", boards, errors);
+  return (errors == 0) ? 0 : 1;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Checks maxTile and engineGameOver() of a game against its board.
+ *
+ ****************************************************************************/
+
+static tBool summaryRight(const tGame *pGame)
+{
+  tBool over = (engineGameOver(pGame)) ? TRUE : FALSE;
+
+  if (pGame->maxTile != engineMaxTile(pGame->board)) {
+    return FALSE;
+  }
+  return (tBool)(over != canMove(pGame->board));
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Brute force check whether any move changes the board.
+ *
+ ****************************************************************************/
+
+static tBool canMove(tBoard board)
+{
+  tU8 merges;
+  tU8 dir;
+
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    if (engineMove(board, dir, &merges) != board) {
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    A random board, either any mix of tiles or a full board of the three
+ *    largest tiles.
+ *
+ ****************************************************************************/
+
+static tBoard randomBoard(tRng *pRng, tBool full)
+{
+  tBoard board = 0;
+  tU8 k;
+
+  for (k = 0; k < (tU8)ENGINE_CELLS; ++k) {
+    if (full == (tBool)TRUE) {
+      board |= (tBoard)(13 + (rngNext(pRng) % 3)) << (k * 4);
+    } else {
+      board |= (tBoard)(rngNext(pRng) % 16) << (k * 4);
+    }
+  }
+  return board;
+}
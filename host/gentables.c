@@ -0,0 +1,158 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    gentables.c
+ *
+ * Description:
+ *    Host tool generating the engine lookup tables as C source.
+ *    Every entry is produced by the reference kernels in engine.c and
+ *    ai.c, so the tables cannot drift from the loop based code.
+ *
+ *    Usage: gentables full    > engine_tables.c
+ *           gentables compact > engine_tables.c
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <string.h>
+#include "engine.h"
+#include "ai.h"
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static tU16 reverseRow(tU16 row);
+static void printTable(const char *pName, const char *pDefine, tBool right);
+static void printCompactTable(void);
+static void printScoreTable(void);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes the requested table set to stdout.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  if ((argc < 2) ||
+      ((strcmp(argv[1], "full") != 0) && (strcmp(argv[1], "compact") != 0))) {
+    fprintf(stderr, "usage: %s full|compact\n", argv[0]);
+    return 1;
+  }
+
+  printf("/* Generated by host/gentables %s, do not edit. */\n", argv[1]);
+  printf("#include \"engine.h\"\n");
+  printf("#include \"ai.h\"\n\n");
+  if (strcmp(argv[1], "full") == 0) {
+    printf("#if defined(ENGINE_TABLES_FULL)\n");
+    printTable("engineRowLeft", "ENGINE_ROW_ENTRIES", FALSE);
+    printTable("engineRowRight", "ENGINE_ROW_ENTRIES", TRUE);
+    printScoreTable();
+    printf("#endif\n");
+  } else {
+    printf("#if defined(ENGINE_TABLES_COMPACT)\n");
+    printCompactTable();
+    printf("#endif\n");
+  }
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Prints one 65536 entry row slide table.
+ *
+ ****************************************************************************/
+
+static void printTable(const char *pName, const char *pDefine, tBool right)
+{
+  tU32 row;
+  tU16 result;
+  tU8 merges;
+
+  printf("const tU16 %s[%s] = {", pName, pDefine);
+  for (row = 0; row < 65536; ++row) {
+    merges = 0;
+    if (right == TRUE) {
+      result = reverseRow(engineSlideRow(reverseRow((tU16)row), &merges));
+    } else {
+      result = engineSlideRow((tU16)row, &merges);
+    }
+    printf("%s0x%04x,", ((row % 8) == 0) ? "\n  " : " ", result);
+  }
+  printf("\n};\n\n");
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Prints the left slide table for rows with exponents 0..11, entry
+ *    a + 12 * (b + 12 * (c + 12 * d)) holding the row with nibbles a, b, c, d.
+ *
+ ****************************************************************************/
+
+static void printCompactTable(void)
+{
+  tU32 index;
+  tU16 row;
+  tU8 merges;
+
+  printf("const tU16 engineRowCompact[ENGINE_ROW_ENTRIES] = {");
+  for (index = 0; index < 12 * 12 * 12 * 12; ++index) {
+    row = (tU16)((index % 12) | (((index / 12) % 12) << 4) |
+                 (((index / 144) % 12) << 8) | ((index / 1728) << 12));
+    merges = 0;
+    printf("%s0x%04x,", ((index % 8) == 0) ? "\n  " : " ",
+           engineSlideRow(row, &merges));
+  }
+  printf("\n};\n\n");
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Prints the heuristic value of every row. The weights it was made with
+ *    are checked when the table is compiled.
+ *
+ ****************************************************************************/
+
+static void printScoreTable(void)
+{
+  tU32 row;
+
+  printf("#if (AI_BASE_SCORE != %d) || (AI_EMPTY_WEIGHT != %d) || "
+         "(AI_MERGE_WEIGHT != %d) || \\\n    (AI_MONO_WEIGHT != %d) || "
+         "(AI_SUM_WEIGHT != %d)\n",
+         AI_BASE_SCORE, AI_EMPTY_WEIGHT, AI_MERGE_WEIGHT, AI_MONO_WEIGHT,
+         AI_SUM_WEIGHT);
+  printf("#error \"engine_tables.c was generated with other AI weights\"\n");
+  printf("#endif\n\n");
+
+  printf("const tS32 aiRowScore[ENGINE_ROW_ENTRIES] = {");
+  for (row = 0; row < 65536; ++row) {
+    printf("%s%d,", ((row % 8) == 0) ? "\n  " : " ", (int)aiLineScore((tU16)row));
+  }
+  printf("\n};\n\n");
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reverses the order of the four nibbles of a line.
+ *
+ ****************************************************************************/
+
+static tU16 reverseRow(tU16 row)
+{
+  return (tU16)((row >> 12) | ((row >> 4) & 0x00f0) |
+                ((row << 4) & 0x0f00) | (row << 12));
+}
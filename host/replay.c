@@ -0,0 +1,172 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    replay.c
+ *
+ * Description:
+ *    Host tool replaying move logs dumped by the board (see movelog.h)
+ *    through the host engine, to reproduce a game or to measure the
+ *    engine on real games.
+ *
+ *    Usage: replay show|fast [rounds] < dump
+ *
+ *    Every line of the dump starting with "MOVELOG " is one log. show
+ *    prints the board after every move, fast replays each log rounds
+ *    times without output and prints moves per second.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "engine.h"
+#include "movelog.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define LINE_LEN ((2 * MOVELOG_MAX_BYTES) + 64)
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static tBool readLog(const char *pLine, tMoveLog *pLog);
+static void showMove(const tGame *pGame, tU16 changed);
+static double seconds(void);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Replays every log of the dump on stdin.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  static char line[LINE_LEN];
+  tMoveLog log;
+  tGame game;
+  tBool show;
+  tBool same = TRUE;
+  tU32 rounds = 1;
+  tU32 logs = 0;
+  tU32 failed = 0;
+  tU32 r;
+  double start;
+  double time;
+
+  if ((argc < 2) ||
+      ((strcmp(argv[1], "show") != 0) && (strcmp(argv[1], "fast") != 0))) {
+    fprintf(stderr, "usage: %s show|fast [rounds] < dump\n", argv[0]);
+    return 1;
+  }
+  show = (strcmp(argv[1], "show") == 0) ? TRUE : FALSE;
+  if ((argc > 2) && (show == FALSE)) {
+    rounds = (tU32)strtoul(argv[2], NULL, 0);
+  }
+
+  while (fgets(line, sizeof(line), stdin) != NULL) {
+    if (strncmp(line, "MOVELOG ", 8) != 0) {
+      continue;
+    }
+    if (readLog(&line[8], &log) == FALSE) {
+      fprintf(stderr, "log %u is damaged\n", logs + 1);
+      failed++;
+      continue;
+    }
+    logs++;
+    printf("log %u: seed 0x%08x, %u moves\n", logs, log.seed, log.count);
+
+    start = seconds();
+    for (r = 0; r < rounds; ++r) {
+      same = moveLogReplay(&log, &game, (show == TRUE) ? showMove : NULL);
+    }
+    time = seconds() - start;
+
+    printf("  score %u merges, max tile %u, %s\n", game.score, 1 << game.maxTile,
+           (same == TRUE) ? "same final board" : "DIFFERENT final board");
+    if (show == FALSE) {
+      printf("  %.1f M moves/s\n", ((double)rounds * log.count) / time / 1e6);
+    }
+    if (same == FALSE) {
+      failed++;
+    }
+  }
+
+  printf("%u logs, %u failed\n", logs, failed);
+  return (failed == 0) ? 0 : 1;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Decodes the hex digits of one dumped log.
+ *
+ ****************************************************************************/
+
+static tBool readLog(const char *pLine, tMoveLog *pLog)
+{
+  static tU8 buf[MOVELOG_MAX_BYTES];
+  unsigned int byte;
+  tU16 len = 0;
+
+  while ((len < (tU16)MOVELOG_MAX_BYTES) && (sscanf(pLine, "%2x", &byte) == 1)) {
+    buf[len++] = (tU8)byte;
+    pLine += 2;
+  }
+  return moveLogUnpack(pLog, buf, len);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Prints the board after a replayed move.
+ *
+ ****************************************************************************/
+
+static void showMove(const tGame *pGame, tU16 changed)
+{
+  tU8 y;
+  tU8 x;
+  tU8 tile;
+
+  for (y = 0; y < (tU8)ENGINE_SIZE; ++y) {
+    printf(" ");
+    for (x = 0; x < (tU8)ENGINE_SIZE; ++x) {
+      tile = engineGetCell(pGame->board, y, x);
+      if (tile == 0) {
+        printf("     .");
+      } else {
+        printf(" %5u", 1 << tile);
+      }
+      printf("%c", ((changed >> ((y * ENGINE_SIZE) + x)) & 1) ? '*' : ' ');
+    }
+    printf("\n");
+  }
+  printf("\n");
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Wall clock time for the rate.
+ *
+ ****************************************************************************/
+
+static double seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
@@ -0,0 +1,430 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    selfplay.c
+ *
+ * Description:
+ *    Host tool playing games with the engine alone, without keys, LCD or
+ *    operating system, and reporting speed and strength of a policy.
+ *
+ *    The games are spread over worker threads. Every worker owns a range
+ *    of game numbers and takes games from its bottom; a worker running out
+ *    of games steals the upper half of another worker's range. Both ends
+ *    of a range are packed into one 64-bit word changed by compare and
+ *    swap, so no locks are needed. Game n always uses seed + n, hence the
+ *    results do not depend on which worker plays it.
+ *
+ *    The run is repeated with 1, 2, ... threads to print a scaling curve.
+ *
+ *    Usage: selfplay random|greedy|expectimax [games] [depth] [seed] [threads]
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "engine.h"
+#include "ai.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define POLICY_RANDOM     0
+#define POLICY_GREEDY     1
+#define POLICY_EXPECTIMAX 2
+
+#define MAX_WORKERS       255   /* worker ids are a tU8 */
+
+/* Game numbers lo (low word) to hi (high word, exclusive) */
+#define RANGE(lo, hi)     (((tU64)(hi) << 32) | (tU32)(lo))
+#define RANGE_LO(range)   ((tU32)(range))
+#define RANGE_HI(range)   ((tU32)((range) >> 32))
+
+typedef unsigned long long tU64;
+
+typedef struct
+{
+  pthread_t thread;
+  tU8 id;
+  _Atomic tU64 range;       /* games not yet taken, see RANGE() */
+  tAiSearch search;
+  tAiTable *pTable;         /* own transposition table, expectimax only */
+  tRng policyRng;           /* own random stream of the random policy */
+} tWorker;
+
+/* Results of all workers, updated once per game */
+typedef struct
+{
+  _Atomic tU64 moves;
+  _Atomic tU64 score;
+  _Atomic tU64 steals;
+  _Atomic tU64 hits;
+  _Atomic tU64 misses;
+  _Atomic tU64 evictions;
+  _Atomic tU32 histogram[16];
+} tResults;
+
+
+/*****************************************************************************
+ * Local variables
+ ****************************************************************************/
+static tWorker workers[MAX_WORKERS];
+static tU8 numWorkers;
+static tResults results;
+static tU8 policy;
+static tU8 depth = 2;
+static tU32 seed = 1;
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static double runFarm(tU8 threads, tU32 games);
+static void *workerProc(void *arg);
+static tBool takeGame(tWorker *pWorker, tU32 *pGame);
+static tBool stealGames(tWorker *pWorker);
+static void playGame(tWorker *pWorker, tU32 game);
+static tU8 chooseMove(tWorker *pWorker, tBoard board);
+static tU8 randomMove(tWorker *pWorker, tBoard board);
+static tU8 greedyMove(tBoard board);
+static double seconds(void);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays the games with 1 to the given number of threads and prints the
+ *    scaling curve and the statistics of the last run.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  static const char *pNames[] = {"random", "greedy", "expectimax"};
+  tU32 games = 100;
+  long threads = sysconf(_SC_NPROCESSORS_ONLN);
+  double time = 0;
+  double single = 0;
+  tU32 t;
+  tU8 i;
+
+  for (policy = 0; policy < (tU8)3; ++policy) {
+    if ((argc > 1) && (strcmp(argv[1], pNames[policy]) == 0)) {
+      break;
+    }
+  }
+  if (policy == (tU8)3) {
+    fprintf(stderr, "usage: %s random|greedy|expectimax [games] [depth] [seed] [threads]\n",
+            argv[0]);
+    return 1;
+  }
+  if (argc > 2) {
+    games = (tU32)strtoul(argv[2], NULL, 0);
+  }
+  if (argc > 3) {
+    depth = (tU8)strtoul(argv[3], NULL, 0);
+  }
+  if (argc > 4) {
+    seed = (tU32)strtoul(argv[4], NULL, 0);
+  }
+  if (argc > 5) {
+    threads = strtol(argv[5], NULL, 0);
+  }
+  if (threads < 1) {
+    threads = 1;
+  }
+  if (threads > MAX_WORKERS) {
+    threads = MAX_WORKERS;
+  }
+
+  printf("policy %s", pNames[policy]);
+  if (policy == (tU8)POLICY_EXPECTIMAX) {
+    printf(", depth %u", depth);
+  }
+  printf(", %u games, seed %u\n", games, seed);
+  printf("  threads  games/s  speedup  steals\n");
+  for (t = 1; t <= (tU32)threads; ++t) {
+    time = runFarm((tU8)t, games);
+    if (t == (tU32)1) {
+      single = time;
+    }
+    printf("  %7u %8.2f %8.2f %7llu\n", t, games / time, single / time,
+           (unsigned long long)results.steals);
+  }
+
+  printf("  %.0f moves/s, %.2f games/s, %.1f s\n",
+         results.moves / time, games / time, time);
+  printf("  average score %.1f merges, %.1f moves\n",
+         (double)results.score / games, (double)results.moves / games);
+  if (policy == (tU8)POLICY_EXPECTIMAX) {
+    printf("  table hits %llu, misses %llu, evictions %llu\n",
+           (unsigned long long)results.hits, (unsigned long long)results.misses,
+           (unsigned long long)results.evictions);
+  }
+  printf("  max tile:\n");
+  for (i = 1; i < (tU8)16; ++i) {
+    if (results.histogram[i] != 0) {
+      printf("  %6u %6u  %5.1f %%\n", 1 << i, results.histogram[i],
+             100.0 * results.histogram[i] / games);
+    }
+  }
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays all games on the given number of worker threads.
+ *
+ * Return: wall clock time in seconds
+ *
+ ****************************************************************************/
+
+static double runFarm(tU8 threads, tU32 games)
+{
+  double start;
+  tU8 i;
+
+  memset(&results, 0, sizeof(results));
+  numWorkers = threads;
+  for (i = 0; i < threads; ++i) {
+    workers[i].id = i;
+    atomic_store(&workers[i].range,
+                 RANGE((tU64)games * i / threads, (tU64)games * (i + 1) / threads));
+    if ((policy == (tU8)POLICY_EXPECTIMAX) && (workers[i].pTable == NULL)) {
+      workers[i].pTable = malloc(sizeof(tAiTable));
+      if (workers[i].pTable == NULL) {
+        fprintf(stderr, "out of memory for the transposition tables\n");
+        exit(1);
+      }
+    }
+    if (workers[i].pTable != NULL) {
+      aiTableClear(workers[i].pTable);
+    }
+  }
+
+  start = seconds();
+  for (i = 0; i < threads; ++i) {
+    pthread_create(&workers[i].thread, NULL, workerProc, &workers[i]);
+  }
+  for (i = 0; i < threads; ++i) {
+    pthread_join(workers[i].thread, NULL);
+  }
+  return seconds() - start;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Worker thread, plays its own games, then steals from the others until
+ *    no games are left.
+ *
+ ****************************************************************************/
+
+static void *workerProc(void *arg)
+{
+  tWorker *pWorker = (tWorker *)arg;
+  tU32 game;
+
+  memset(&pWorker->search, 0, sizeof(pWorker->search));
+  pWorker->search.depth = depth;
+  pWorker->search.pTable = pWorker->pTable;
+
+  do {
+    while (takeGame(pWorker, &game) == TRUE) {
+      playGame(pWorker, game);
+    }
+  } while (stealGames(pWorker) == TRUE);
+
+  if (pWorker->pTable != NULL) {
+    atomic_fetch_add(&results.hits, pWorker->pTable->hits);
+    atomic_fetch_add(&results.misses, pWorker->pTable->misses);
+    atomic_fetch_add(&results.evictions, pWorker->pTable->evictions);
+  }
+  return NULL;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Takes the lowest game of the worker's own range.
+ *
+ ****************************************************************************/
+
+static tBool takeGame(tWorker *pWorker, tU32 *pGame)
+{
+  tU64 range = atomic_load(&pWorker->range);
+
+  while (RANGE_LO(range) < RANGE_HI(range)) {
+    if (atomic_compare_exchange_weak(&pWorker->range, &range,
+                                     RANGE(RANGE_LO(range) + 1, RANGE_HI(range)))) {
+      *pGame = RANGE_LO(range);
+      return TRUE;
+    }
+  }
+  return FALSE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves the upper half of another worker's range to the empty range of
+ *    this worker. A range with a single game is taken completely.
+ *
+ * Return: FALSE if no worker has games left
+ *
+ ****************************************************************************/
+
+static tBool stealGames(tWorker *pWorker)
+{
+  tU64 range;
+  tU32 lo;
+  tU32 hi;
+  tU32 mid;
+  tU8 i;
+  tU8 victim;
+
+  for (i = 1; i < numWorkers; ++i) {
+    victim = (tU8)((pWorker->id + i) % numWorkers);
+    range = atomic_load(&workers[victim].range);
+    for (;;) {
+      lo = RANGE_LO(range);
+      hi = RANGE_HI(range);
+      if (lo >= hi) {
+        break;
+      }
+      mid = lo + ((hi - lo) / 2);
+      if (atomic_compare_exchange_weak(&workers[victim].range, &range, RANGE(lo, mid))) {
+        atomic_store(&pWorker->range, RANGE(mid, hi));
+        atomic_fetch_add(&results.steals, 1);
+        return TRUE;
+      }
+    }
+  }
+  return FALSE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays game number game and adds it to the results.
+ *
+ ****************************************************************************/
+
+static void playGame(tWorker *pWorker, tU32 game)
+{
+  tGame g;
+  tU32 moves = 0;
+  tU8 dir;
+
+  engineNewGame(&g, seed + game);
+  rngSeed(&pWorker->policyRng, ~(seed + game));
+  while (!engineGameOver(&g)) {
+    dir = chooseMove(pWorker, g.board);
+    if ((dir == (tU8)AI_NO_MOVE) || (engineStep(&g, dir) == (tU16)ENGINE_NO_MOVE)) {
+      break;
+    }
+    moves++;
+  }
+
+  atomic_fetch_add(&results.moves, moves);
+  atomic_fetch_add(&results.score, g.score);
+  atomic_fetch_add(&results.histogram[g.maxTile], 1);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Asks the policy for the next move.
+ *
+ * Return: a direction, AI_NO_MOVE if the game is over
+ *
+ ****************************************************************************/
+
+static tU8 chooseMove(tWorker *pWorker, tBoard board)
+{
+  switch (policy) {
+    case POLICY_RANDOM:
+      return randomMove(pWorker, board);
+    case POLICY_GREEDY:
+      return greedyMove(board);
+    default:
+      return aiBestMove(&pWorker->search, board);
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Picks one of the possible moves at random.
+ *
+ ****************************************************************************/
+
+static tU8 randomMove(tWorker *pWorker, tBoard board)
+{
+  tU8 moves[4];
+  tU8 count = 0;
+  tU8 merges;
+  tU8 dir;
+
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    if (engineMove(board, dir, &merges) != board) {
+      moves[count++] = dir;
+    }
+  }
+  if (count == (tU8)0) {
+    return AI_NO_MOVE;
+  }
+  return moves[rngNext(&pWorker->policyRng) % count];
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Picks the possible move with the most merges, the first one on a tie.
+ *
+ ****************************************************************************/
+
+static tU8 greedyMove(tBoard board)
+{
+  tU8 best = AI_NO_MOVE;
+  tU8 bestMerges = 0;
+  tU8 merges;
+  tU8 dir;
+
+  for (dir = 0; dir < (tU8)4; ++dir) {
+    merges = 0;
+    if ((engineMove(board, dir, &merges) != board) &&
+        ((best == (tU8)AI_NO_MOVE) || (merges > bestMerges))) {
+      best = dir;
+      bestMerges = merges;
+    }
+  }
+  return best;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Wall clock time for the throughput report.
+ *
+ ****************************************************************************/
+
+static double seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
@@ -0,0 +1,454 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    train.c
+ *
+ * Description:
+ *    Host tool training the n-tuple network of ai.c with TD(0) learning
+ *    on afterstates (the board after a move, before the spawn). The
+ *    network learns to predict the points still to be gained, a merge
+ *    into a tile of value v being worth v points. The search adds the
+ *    points of the moves on its path to these values (see ai.c).
+ *
+ *    The trained weights are quantized to 8 bit codes into a table of 256
+ *    levels in points, placed by Lloyd's algorithm on the weights weighted
+ *    by how often training visited them, so the error is small where the
+ *    search reads the network. The
+ *    quantization error is reported together with greedy games of the
+ *    float and the quantized network, and the result is written as C
+ *    source.
+ *
+ *    Usage: train <games> [seed] > ntuple_weights.c
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <time.h>
+#include "engine.h"
+#include "ai.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define LEARNING_RATE   0.0025f
+#define REPORT_INTERVAL 1000
+#define EVAL_GAMES      1000    /* greedy games comparing float and quantized weights */
+#define LLOYD_ROUNDS    20
+
+typedef float tWeights[AI_NTUPLE_TUPLES][AI_NTUPLE_ENTRIES];
+
+typedef struct
+{
+  float weight;
+  tU32  visits;
+} tSample;
+
+
+/*****************************************************************************
+ * Local variables
+ ****************************************************************************/
+static tWeights weights;
+static tWeights quantized;          // weights replaced by their levels
+static tS32 levels[AI_NTUPLE_LEVELS];
+static tU8 codes[AI_NTUPLE_TUPLES][AI_NTUPLE_ENTRIES];
+static tU32 visits[AI_NTUPLE_TUPLES][AI_NTUPLE_ENTRIES];
+static tU32 rowPoints[65536];
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static void initPoints(void);
+static tU32 points(tBoard board);
+static float value(tWeights *pWeights, tBoard board);
+static void update(tBoard board, float delta);
+static tU32 playGame(tWeights *pWeights, tBool learn, tU32 seed, tU8 *pMaxTile);
+static void evalGames(tWeights *pWeights, tU32 seed, const char *pName);
+static void quantize(void);
+static int compareSamples(const void *pA, const void *pB);
+static tU8 nearestLevel(float weight);
+static void printWeights(tU32 games);
+static double seconds(void);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Trains the network for the given number of games and prints it.
+ *
+ ****************************************************************************/
+
+int main(int argc, char *argv[])
+{
+  tU32 games;
+  tU32 seed = 1;
+  tU32 game;
+  tU32 won = 0;
+  tU32 played = 0;
+  double total = 0;
+  double start;
+  double now;
+  tU8 maxTile;
+
+  if (argc < 2) {
+    fprintf(stderr, "usage: %s games [seed]\n", argv[0]);
+    return 1;
+  }
+  games = (tU32)strtoul(argv[1], NULL, 0);
+  if (argc > 2) {
+    seed = (tU32)strtoul(argv[2], NULL, 0);
+  }
+
+  initPoints();
+  start = seconds();
+  for (game = 1; game <= games; ++game) {
+    total += playGame(&weights, TRUE, seed + game, &maxTile);
+    played++;
+    if (maxTile >= (tU8)ENGINE_WIN_TILE) {
+      won++;
+    }
+
+    if (((game % REPORT_INTERVAL) == 0) || (game == games)) {
+      now = seconds();
+      fprintf(stderr, "%8u games  %8.1f games/s  avg score %8.0f  2048 reached %5.1f %%\n",
+              game, game / (now - start), total / played, 100.0 * won / played);
+      total = 0;
+      won = 0;
+      played = 0;
+    }
+  }
+
+  quantize();
+  evalGames(&weights, seed + games, "float");
+  evalGames(&quantized, seed + games, "quantized");
+  printWeights(games);
+  return 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays one game with the greedy policy of the network and, when
+ *    learning, updates the weights after every move.
+ *
+ * Return: points of the game
+ *
+ ****************************************************************************/
+
+static tU32 playGame(tWeights *pWeights, tBool learn, tU32 seed, tU8 *pMaxTile)
+{
+  tRng rng;
+  tBoard board;
+  tBoard after;
+  tBoard bestAfter = 0;
+  tBoard prevAfter = 0;
+  float bestValue;
+  float v;
+  tU32 reward;
+  tU32 bestReward = 0;
+  tU32 score = 0;
+  tBool moved;
+  tU8 merges;
+  tU8 dir;
+
+  rngSeed(&rng, seed);
+  board = engineSpawn(engineSpawn(0, rngNext(&rng)), rngNext(&rng));
+
+  for (;;) {
+    bestValue = 0.0f;
+    moved = FALSE;
+    for (dir = 0; dir < (tU8)4; ++dir) {
+      after = engineMove(board, dir, &merges);
+      if (after == board) {
+        continue;
+      }
+      reward = points(after) - points(board);
+      v = (float)reward + value(pWeights, after);
+      if ((moved == (tBool)FALSE) || (v > bestValue)) {
+        moved = TRUE;
+        bestValue = v;
+        bestAfter = after;
+        bestReward = reward;
+      }
+    }
+
+    //the previous afterstate learns from the best move out of its successor
+    if (moved == (tBool)FALSE) {
+      if ((learn == (tBool)TRUE) && (prevAfter != 0)) {
+        update(prevAfter, -value(pWeights, prevAfter));
+      }
+      break;
+    }
+    if ((learn == (tBool)TRUE) && (prevAfter != 0)) {
+      update(prevAfter, bestValue - value(pWeights, prevAfter));
+    }
+
+    score += bestReward;
+    prevAfter = bestAfter;
+    board = engineSpawn(bestAfter, rngNext(&rng));
+  }
+
+  *pMaxTile = engineMaxTile(board);
+  return score;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Value of an afterstate predicted by the network.
+ *
+ ****************************************************************************/
+
+static float value(tWeights *pWeights, tBoard board)
+{
+  tU16 features[AI_NTUPLE_FEATURES];
+  float sum = 0.0f;
+  tU8 i;
+
+  aiNtupleFeatures(board, features);
+  for (i = 0; i < (tU8)(AI_NTUPLE_FEATURES / 2); ++i) {
+    sum += (*pWeights)[0][features[i]];
+    sum += (*pWeights)[1][features[i + (AI_NTUPLE_FEATURES / 2)]];
+  }
+  return sum;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves the prediction for a board by delta, spread over its features.
+ *
+ ****************************************************************************/
+
+static void update(tBoard board, float delta)
+{
+  tU16 features[AI_NTUPLE_FEATURES];
+  float step = LEARNING_RATE * delta;
+  tU8 i;
+
+  aiNtupleFeatures(board, features);
+  for (i = 0; i < (tU8)(AI_NTUPLE_FEATURES / 2); ++i) {
+    weights[0][features[i]] += step;
+    weights[1][features[i + (AI_NTUPLE_FEATURES / 2)]] += step;
+    visits[0][features[i]]++;
+    visits[1][features[i + (AI_NTUPLE_FEATURES / 2)]]++;
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Points potential of a board: a tile 2^e counts (e-1) * 2^e, which is
+ *    what it took to build it by merges. Sliding keeps the potential and a
+ *    merge raises it by the value of the merged tile, so the points of a
+ *    move are the difference of the potentials before and after it.
+ *
+ ****************************************************************************/
+
+static void initPoints(void)
+{
+  tU32 row;
+  tU32 tile;
+  tU8 k;
+
+  for (row = 0; row < 65536; ++row) {
+    rowPoints[row] = 0;
+    for (k = 0; k < (tU8)ENGINE_SIZE; ++k) {
+      tile = (row >> (k * 4)) & 0x0f;
+      if (tile > 1) {
+        rowPoints[row] += (tile - 1) << tile;
+      }
+    }
+  }
+}
+
+static tU32 points(tBoard board)
+{
+  return rowPoints[(tU16)board] + rowPoints[(tU16)(board >> 16)] +
+         rowPoints[(tU16)(board >> 32)] + rowPoints[(tU16)(board >> 48)];
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays greedy games without learning and reports them, the same games
+ *    for both weight sets.
+ *
+ ****************************************************************************/
+
+static void evalGames(tWeights *pWeights, tU32 seed, const char *pName)
+{
+  double total = 0;
+  tU32 won = 0;
+  tU32 game;
+  tU8 maxTile;
+
+  for (game = 1; game <= (tU32)EVAL_GAMES; ++game) {
+    total += playGame(pWeights, FALSE, seed + game, &maxTile);
+    if (maxTile >= (tU8)ENGINE_WIN_TILE) {
+      won++;
+    }
+  }
+  fprintf(stderr, "%-9s %u greedy games  avg score %8.0f  2048 reached %5.1f %%\n",
+          pName, EVAL_GAMES, total / EVAL_GAMES, 100.0 * won / EVAL_GAMES);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Places the levels with Lloyd's algorithm, starting from ranges of the
+ *    sorted weights visited equally often, codes every weight by its
+ *    nearest level and reports the error per visit.
+ *
+ ****************************************************************************/
+
+static void quantize(void)
+{
+  static tSample samples[AI_NTUPLE_TUPLES * AI_NTUPLE_ENTRIES];
+  static double sums[AI_NTUPLE_LEVELS];
+  static double counts[AI_NTUPLE_LEVELS];
+  const tU32 n = AI_NTUPLE_TUPLES * AI_NTUPLE_ENTRIES;
+  float *pAll = &weights[0][0];
+  tU32 *pVisits = &visits[0][0];
+  double total = 0;
+  double seen = 0;
+  double error = 0;
+  double diff;
+  tU32 round;
+  tU32 i;
+  tU16 level;
+
+  for (i = 0; i < n; ++i) {
+    samples[i].weight = pAll[i];
+    samples[i].visits = pVisits[i];
+    total += pVisits[i];
+  }
+  qsort(samples, n, sizeof(tSample), compareSamples);
+
+  //level k starts in the middle of the k-th range of equal visits
+  level = 0;
+  for (i = 0; (i < n) && (level < (tU16)AI_NTUPLE_LEVELS); ++i) {
+    seen += samples[i].visits;
+    while ((level < (tU16)AI_NTUPLE_LEVELS) &&
+           (seen >= total * (2 * level + 1) / (2 * AI_NTUPLE_LEVELS))) {
+      levels[level++] = (tS32)lrintf(samples[i].weight);
+    }
+  }
+
+  for (round = 0; round < (tU32)LLOYD_ROUNDS; ++round) {
+    for (level = 0; level < (tU16)AI_NTUPLE_LEVELS; ++level) {
+      sums[level] = 0;
+      counts[level] = 0;
+    }
+    for (i = 0; i < n; ++i) {
+      level = nearestLevel(samples[i].weight);
+      sums[level] += (double)samples[i].weight * samples[i].visits;
+      counts[level] += samples[i].visits;
+    }
+    for (level = 0; level < (tU16)AI_NTUPLE_LEVELS; ++level) {
+      if (counts[level] != 0) {
+        levels[level] = (tS32)lrint(sums[level] / counts[level]);
+      }
+    }
+  }
+
+  for (i = 0; i < n; ++i) {
+    codes[i / AI_NTUPLE_ENTRIES][i % AI_NTUPLE_ENTRIES] = nearestLevel(pAll[i]);
+    quantized[i / AI_NTUPLE_ENTRIES][i % AI_NTUPLE_ENTRIES] =
+      (float)levels[codes[i / AI_NTUPLE_ENTRIES][i % AI_NTUPLE_ENTRIES]];
+    diff = quantized[i / AI_NTUPLE_ENTRIES][i % AI_NTUPLE_ENTRIES] - pAll[i];
+    error += diff * diff * pVisits[i];
+  }
+  fprintf(stderr, "quantized to %u levels from %d to %d points, rms error %.2f points per visit\n",
+          AI_NTUPLE_LEVELS, levels[0], levels[AI_NTUPLE_LEVELS - 1],
+          (total > 0) ? sqrt(error / total) : 0.0);
+}
+
+static int compareSamples(const void *pA, const void *pB)
+{
+  float a = ((const tSample *)pA)->weight;
+  float b = ((const tSample *)pB)->weight;
+
+  return (a > b) - (a < b);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Index of the level closest to a weight, the levels being sorted.
+ *
+ ****************************************************************************/
+
+static tU8 nearestLevel(float weight)
+{
+  tU16 lo = 0;
+  tU16 hi = AI_NTUPLE_LEVELS - 1;
+  tU16 mid;
+
+  while (lo < hi) {
+    mid = (tU16)((lo + hi) / 2);
+    if (weight > 0.5f * (float)(levels[mid] + levels[mid + 1])) {
+      lo = (tU16)(mid + 1);
+    } else {
+      hi = mid;
+    }
+  }
+  return (tU8)lo;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Prints the level table and the codes of the weights.
+ *
+ ****************************************************************************/
+
+static void printWeights(tU32 games)
+{
+  tU32 i;
+  tU8 tuple;
+
+  printf("/* Generated by host/train %u, do not edit. */\n", games);
+  printf("#include \"engine.h\"\n");
+  printf("#include \"ai.h\"\n\n");
+  printf("#if defined(AI_EVAL_NTUPLE)\n");
+  printf("const tS32 aiNtupleLevels[AI_NTUPLE_LEVELS] = {");
+  for (i = 0; i < AI_NTUPLE_LEVELS; ++i) {
+    printf("%s%d,", ((i % 8) == 0) ? "\n  " : " ", levels[i]);
+  }
+  printf("\n};\n\n");
+  printf("const tU8 aiNtupleWeights[AI_NTUPLE_TUPLES][AI_NTUPLE_ENTRIES] = {");
+  for (tuple = 0; tuple < (tU8)AI_NTUPLE_TUPLES; ++tuple) {
+    printf("\n {");
+    for (i = 0; i < AI_NTUPLE_ENTRIES; ++i) {
+      printf("%s%u,", ((i % 16) == 0) ? "\n  " : " ", codes[tuple][i]);
+    }
+    printf("\n },");
+  }
+  printf("\n};\n");
+  printf("#endif\n");
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Wall clock time for the throughput report.
+ *
+ ****************************************************************************/
+
+static double seconds(void)
+{
+  struct timespec now;
+
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + (now.tv_nsec / 1e9);
+}
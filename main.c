@@ -113,9 +113,9 @@ drawMenuCursor(tU8 cursor)
 {
   tU32 row;
 
-  for(row=0; row<6; row++)
+  for(row=0; row<7; row++)
   {
-    lcdGotoxy(1,20+(14*row));
+    lcdGotoxy(1,18+(14*row));
     if(row == cursor)
       lcdColor(0x00,0xe0);
     else
@@ -125,10 +125,11 @@ drawMenuCursor(tU8 cursor)
     {
       case 0: lcdPuts((tU8 *)"Play 2048-Client"); break;
       case 1: lcdPuts((tU8 *)"Play 2048"); break;
-      case 2: lcdPuts((tU8 *)"Play 2048-Server"); break;
-      case 3: lcdPuts((tU8 *)"Bluetooth"); break;
-      case 4: lcdPuts((tU8 *)"Show Scores"); break;
-      case 5: lcdPuts((tU8 *)"Clear Score"); break;
+      case 2: lcdPuts((tU8 *)"Resume"); break;
+      case 3: lcdPuts((tU8 *)"Play 2048-Server"); break;
+      case 4: lcdPuts((tU8 *)"Bluetooth"); break;
+      case 5: lcdPuts((tU8 *)"Show Scores"); break;
+      case 6: lcdPuts((tU8 *)"Clear Score"); break;
       default: break;
     }
   }
@@ -212,13 +213,14 @@ proc1(void* arg)
         switch(cursor)
         {
           case 0: startGameAsClient(); break;
-          case 1: play2048(0); break;
+          case 1: startSingleGame(); break;
+          case 2: resumeGame(); break;
 
-          case 2: startGameAsServer(); break;
+          case 3: startGameAsServer(); break;
 
-          case 3: handleBt(); break;
-          case 4: displayScores(); break;
-          case 5: clearScores(); break;
+          case 4: handleBt(); break;
+          case 5: displayScores(); break;
+          case 6: clearScores(); break;
           default: break;
         }
         drawMenu();
@@ -230,14 +232,14 @@ proc1(void* arg)
         if (cursor > 0)
           cursor--;
         else
-          cursor = 5;
+          cursor = 6;
         drawMenuCursor(cursor);
       }
       
       //move cursor down
       else if (anyKey == KEY_DOWN)
       {
-        if (cursor < 5)
+        if (cursor < 6)
           cursor++;
         else
           cursor = 0;
@@ -0,0 +1,245 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    movelog.c
+ *
+ * Description:
+ *    Implements the move log of a game. Has no dependencies on the
+ *    operating system or the board hardware.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "movelog.h"
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static void putLittle(tU8 *pBuf, tBoard value, tU8 bytes);
+static tBoard getLittle(const tU8 *pBuf, tU8 bytes);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Starts an empty log for a game started with engineNewGame(seed).
+ *
+ ****************************************************************************/
+
+void moveLogStart(tMoveLog *pLog, tU32 seed)
+{
+  tGame start;
+
+  //an empty log replays to the start board
+  engineNewGame(&start, seed);
+  pLog->seed = seed;
+  pLog->count = 0;
+  pLog->final = start.board;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Appends a move. Only moves that changed the board may be logged.
+ *
+ * Return: TRUE if logged, FALSE if the log is full
+ *
+ ****************************************************************************/
+
+tBool moveLogAdd(tMoveLog *pLog, tU8 dir)
+{
+  tU8 shift = (tU8)((pLog->count & 3) * 2);
+
+  if (pLog->count >= (tU16)MOVELOG_MAX_MOVES) {
+    return FALSE;
+  }
+  if (shift == (tU8)0) {
+    pLog->moves[pLog->count >> 2] = 0;
+  }
+  pLog->moves[pLog->count >> 2] |= (tU8)((dir & 3) << shift);
+  pLog->count++;
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Records the board the game ended with.
+ *
+ ****************************************************************************/
+
+void moveLogFinish(tMoveLog *pLog, tBoard board)
+{
+  pLog->final = board;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Forgets the moves after the first count, for an undone move. board
+ *    is the board after move count. A log that is already shorter, since
+ *    it filled up before, stays as it is.
+ *
+ ****************************************************************************/
+
+void moveLogTruncate(tMoveLog *pLog, tU16 count, tBoard board)
+{
+  if (count >= pLog->count) {
+    return;
+  }
+  pLog->count = count;
+  pLog->final = board;
+  if ((count & 3) != 0) {
+    pLog->moves[count >> 2] &= (tU8)((1 << ((count & 3) * 2)) - 1);
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Returns move i of the log.
+ *
+ ****************************************************************************/
+
+tU8 moveLogGet(const tMoveLog *pLog, tU16 i)
+{
+  return (tU8)((pLog->moves[i >> 2] >> ((i & 3) * 2)) & 3);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes the packed form of the log.
+ *
+ * Params:
+ *    [in]  pLog - The log.
+ *    [out] pBuf - At least MOVELOG_MAX_BYTES bytes.
+ *
+ * Return: number of bytes written
+ *
+ ****************************************************************************/
+
+tU16 moveLogPack(const tMoveLog *pLog, tU8 *pBuf)
+{
+  tU16 bytes = (tU16)((pLog->count + 3) >> 2);
+  tU16 i;
+
+  putLittle(&pBuf[0], MOVELOG_MAGIC, 2);
+  putLittle(&pBuf[2], pLog->seed, 4);
+  putLittle(&pBuf[6], pLog->count, 2);
+  putLittle(&pBuf[8], pLog->final, 8);
+  for (i = 0; i < bytes; ++i) {
+    pBuf[MOVELOG_HEADER + i] = pLog->moves[i];
+  }
+  return (tU16)(MOVELOG_HEADER + bytes);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reads a log written by moveLogPack().
+ *
+ * Params:
+ *    [out] pLog - The log.
+ *    [in]  pBuf - The packed form.
+ *    [in]  len  - Number of bytes available in pBuf.
+ *
+ * Return: FALSE if pBuf does not hold a complete log
+ *
+ ****************************************************************************/
+
+tBool moveLogUnpack(tMoveLog *pLog, const tU8 *pBuf, tU16 len)
+{
+  tU16 bytes;
+  tU16 i;
+
+  if ((len < (tU16)MOVELOG_HEADER) ||
+      (getLittle(&pBuf[0], 2) != (tBoard)MOVELOG_MAGIC)) {
+    return FALSE;
+  }
+  pLog->seed = (tU32)getLittle(&pBuf[2], 4);
+  pLog->count = (tU16)getLittle(&pBuf[6], 2);
+  pLog->final = getLittle(&pBuf[8], 8);
+  bytes = (tU16)((pLog->count + 3) >> 2);
+  if ((pLog->count > (tU16)MOVELOG_MAX_MOVES) ||
+      (len < (tU16)(MOVELOG_HEADER + bytes))) {
+    return FALSE;
+  }
+  for (i = 0; i < bytes; ++i) {
+    pLog->moves[i] = pBuf[MOVELOG_HEADER + i];
+  }
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays the logged game again through the engine.
+ *
+ * Params:
+ *    [in]  pLog  - The log.
+ *    [out] pGame - The game, at the end of the log on return.
+ *    [in]  pShow - Called after the start and after every move with the
+ *                  changed cells, NULL to replay without rendering.
+ *
+ * Return: TRUE if every move changed the board and the game ended with
+ *         the logged final board
+ *
+ ****************************************************************************/
+
+tBool moveLogReplay(const tMoveLog *pLog, tGame *pGame, tMoveLogShow pShow)
+{
+  tBool same = TRUE;
+  tU16 changed;
+  tU16 i;
+
+  engineNewGame(pGame, pLog->seed);
+  if (pShow != NULL) {
+    pShow(pGame, ENGINE_ALL_CELLS);
+  }
+  for (i = 0; i < pLog->count; ++i) {
+    changed = engineStep(pGame, moveLogGet(pLog, i));
+    if (changed == (tU16)ENGINE_NO_MOVE) {
+      same = FALSE;
+    } else if (pShow != NULL) {
+      pShow(pGame, changed);
+    }
+  }
+  if (pGame->board != pLog->final) {
+    same = FALSE;
+  }
+  return same;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Byte order helpers of the packed form.
+ *
+ ****************************************************************************/
+
+static void putLittle(tU8 *pBuf, tBoard value, tU8 bytes)
+{
+  tU8 i;
+
+  for (i = 0; i < bytes; ++i) {
+    pBuf[i] = (tU8)(value >> (i * 8));
+  }
+}
+
+static tBoard getLittle(const tU8 *pBuf, tU8 bytes)
+{
+  tBoard value = 0;
+  tU8 i;
+
+  for (i = 0; i < bytes; ++i) {
+    value |= (tBoard)pBuf[i] << (i * 8);
+  }
+  return value;
+}
@@ -0,0 +1,60 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    movelog.h
+ *
+ * Description:
+ *    Expose the move log of a game: the seed of engineNewGame() and every
+ *    move that changed the board as two bits, four moves per byte. Since
+ *    the spawns follow from the seed, replaying the moves through the
+ *    engine reproduces the game exactly, on the board and on the host.
+ *
+ *****************************************************************************/
+#ifndef _MOVELOG_H_
+#define _MOVELOG_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define MOVELOG_MAX_MOVES 1000
+
+/*
+ * Packed form for the EEPROM and the UART dump, all numbers little
+ * endian: magic (2), seed (4), move count (2), final board (8), then the
+ * moves, move i in bits 2*(i%4) of byte i/4. 266 bytes at most.
+ */
+#define MOVELOG_MAGIC     0x4c4d   /* "ML" */
+#define MOVELOG_HEADER    16
+#define MOVELOG_MAX_BYTES (MOVELOG_HEADER + (MOVELOG_MAX_MOVES / 4))
+
+typedef struct
+{
+  tU32   seed;
+  tU16   count;
+  tBoard final;    /* board after the last move, checked by a replay */
+  tU8    moves[MOVELOG_MAX_MOVES / 4];
+} tMoveLog;
+
+/* Called after every replayed move, see moveLogReplay() */
+typedef void (*tMoveLogShow)(const tGame *pGame, tU16 changed);
+
+
+void  moveLogStart(tMoveLog *pLog, tU32 seed);
+tBool moveLogAdd(tMoveLog *pLog, tU8 dir);
+void  moveLogFinish(tMoveLog *pLog, tBoard board);
+void  moveLogTruncate(tMoveLog *pLog, tU16 count, tBoard board);
+tU8   moveLogGet(const tMoveLog *pLog, tU16 i);
+tU16  moveLogPack(const tMoveLog *pLog, tU8 *pBuf);
+tBool moveLogUnpack(tMoveLog *pLog, const tU8 *pBuf, tU16 len);
+tBool moveLogReplay(const tMoveLog *pLog, tGame *pGame, tMoveLogShow pShow);
+
+#endif
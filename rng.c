@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    rng.c
+ *
+ * Description:
+ *    Implements a 32-bit xorshift random number generator. It needs three
+ *    shifts and three exclusive ors per number, no multiplication or
+ *    division, and its whole state fits in four bytes.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "rng.h"
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Seeds the generator. The seed is hashed first so that nearby seeds,
+ *    e.g. consecutive millisecond counts, start far apart.
+ *
+ ****************************************************************************/
+
+void rngSeed(tRng *pRng, tU32 seed)
+{
+  seed ^= seed >> 16;
+  seed *= 0x7feb352d;
+  seed ^= seed >> 15;
+  seed *= 0x846ca68b;
+  seed ^= seed >> 16;
+  rngSetState(pRng, seed);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Returns the next 32-bit random number.
+ *
+ ****************************************************************************/
+
+tU32 rngNext(tRng *pRng)
+{
+  tU32 x = pRng->state;
+
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  pRng->state = x;
+  return x;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Returns the state, to be saved and later given to rngSetState.
+ *
+ ****************************************************************************/
+
+tU32 rngGetState(const tRng *pRng)
+{
+  return pRng->state;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Restores a state returned by rngGetState.
+ *
+ ****************************************************************************/
+
+void rngSetState(tRng *pRng, tU32 state)
+{
+  if (state == (tU32)0) {
+    state = RNG_DEFAULT_STATE;
+  }
+  pRng->state = state;
+}
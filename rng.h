@@ -0,0 +1,41 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    rng.h
+ *
+ * Description:
+ *    Expose the seedable xorshift random number generator used for tile
+ *    spawns. Two generators seeded alike produce the same sequence on the
+ *    board and on the host.
+ *
+ *****************************************************************************/
+#ifndef _RNG_H_
+#define _RNG_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "../pre_emptive_os/api/general.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+typedef struct
+{
+  tU32 state;
+} tRng;
+
+/* xorshift32 must never hold a zero state */
+#define RNG_DEFAULT_STATE 0x2545f491
+
+
+void rngSeed(tRng *pRng, tU32 seed);
+tU32 rngNext(tRng *pRng);
+tU32 rngGetState(const tRng *pRng);
+void rngSetState(tRng *pRng, tU32 state);
+
+#endif
@@ -0,0 +1,118 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    snapshot.c
+ *
+ * Description:
+ *    Implements the snapshot record of a running game. Has no
+ *    dependencies on the operating system or the board hardware.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "snapshot.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define SNAPSHOT_DATA  14       /* bytes covered by the check */
+#define SNAPSHOT_SEED  0x2048   /* start value of the check */
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static tU16 checkRecord(const tU8 *pBuf);
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes the snapshot record of a game.
+ *
+ * Params:
+ *    [in]  pGame - The game.
+ *    [out] pBuf  - SNAPSHOT_BYTES bytes.
+ *
+ ****************************************************************************/
+
+void snapshotPack(const tGame *pGame, tU8 *pBuf)
+{
+  tU32 state = rngGetState(&pGame->rng);
+  tU16 check;
+  tU8 i;
+
+  for (i = 0; i < (tU8)8; ++i) {
+    pBuf[i] = (tU8)(pGame->board >> (i * 8));
+  }
+  for (i = 0; i < (tU8)4; ++i) {
+    pBuf[8 + i] = (tU8)(state >> (i * 8));
+  }
+  pBuf[12] = (tU8)pGame->score;
+  pBuf[13] = (tU8)(pGame->score >> 8);
+
+  check = checkRecord(pBuf);
+  pBuf[14] = (tU8)check;
+  pBuf[15] = (tU8)(check >> 8);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Restores a game from its snapshot record. The board summary is
+ *    rebuilt, so the game continues as if it had never stopped.
+ *
+ * Return: FALSE if the record is damaged or marks a finished game,
+ *         the game is then left alone
+ *
+ ****************************************************************************/
+
+tBool snapshotUnpack(tGame *pGame, const tU8 *pBuf)
+{
+  tBoard board = 0;
+  tU32 state = 0;
+  tU8 i;
+
+  if ((pBuf[14] | (pBuf[15] << 8)) != checkRecord(pBuf)) {
+    return FALSE;
+  }
+  for (i = 0; i < (tU8)8; ++i) {
+    board |= (tBoard)pBuf[i] << (i * 8);
+  }
+  for (i = 0; i < (tU8)4; ++i) {
+    state |= (tU32)pBuf[8 + i] << (i * 8);
+  }
+  //a game always has tiles and xorshift never holds zero
+  if ((board == 0) || (state == 0)) {
+    return FALSE;
+  }
+
+  pGame->score = (tU16)(pBuf[12] | (pBuf[13] << 8));
+  rngSetState(&pGame->rng, state);
+  engineSetBoard(pGame, board);
+  return TRUE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Check of the data bytes of a record, a rotate and xor per byte.
+ *
+ ****************************************************************************/
+
+static tU16 checkRecord(const tU8 *pBuf)
+{
+  tU16 check = SNAPSHOT_SEED;
+  tU8 i;
+
+  for (i = 0; i < (tU8)SNAPSHOT_DATA; ++i) {
+    check = (tU16)(((check << 3) | (check >> 13)) ^ pBuf[i]);
+  }
+  return check;
+}
@@ -0,0 +1,38 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    snapshot.h
+ *
+ * Description:
+ *    Expose the snapshot of a running game: board, score and generator
+ *    state in one checksummed record of SNAPSHOT_BYTES bytes, small enough
+ *    for one EEPROM page. A game restored from it plays on exactly as the
+ *    saved one would have.
+ *
+ *****************************************************************************/
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+/*
+ * Little endian: board (8), generator state (4), score (2), check (2).
+ * An all zero record is never valid, it marks a finished game.
+ */
+#define SNAPSHOT_BYTES 16
+
+
+void  snapshotPack(const tGame *pGame, tU8 *pBuf);
+tBool snapshotUnpack(tGame *pGame, const tU8 *pBuf);
+
+#endif
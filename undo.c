@@ -0,0 +1,83 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    undo.c
+ *
+ * Description:
+ *    Implements the undo ring of a game. Has no dependencies on the
+ *    operating system or the board hardware.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "undo.h"
+
+#if (UNDO_DEPTH & (UNDO_DEPTH - 1)) != 0
+#error "UNDO_DEPTH must be a power of two"
+#endif
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Forgets all saved states.
+ *
+ ****************************************************************************/
+
+void undoClear(tUndoRing *pRing)
+{
+  pRing->head = 0;
+  pRing->count = 0;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Saves the state of a game, called before a move.
+ *
+ ****************************************************************************/
+
+void undoPush(tUndoRing *pRing, const tGame *pGame)
+{
+  tUndoEntry *pEntry = &pRing->entries[pRing->head];
+
+  pEntry->board = pGame->board;
+  pEntry->rngState = rngGetState(&pGame->rng);
+  pEntry->score = pGame->score;
+  pRing->head = (tU8)((pRing->head + 1) & (UNDO_DEPTH - 1));
+  if (pRing->count < (tU8)UNDO_DEPTH) {
+    pRing->count++;
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Puts the game back into the last saved state. The generator state is
+ *    restored too, so the move played again spawns the same tile.
+ *
+ * Return: FALSE if no state is left
+ *
+ ****************************************************************************/
+
+tBool undoPop(tUndoRing *pRing, tGame *pGame)
+{
+  tUndoEntry *pEntry;
+
+  if (pRing->count == (tU8)0) {
+    return FALSE;
+  }
+  pRing->head = (tU8)((pRing->head - 1) & (UNDO_DEPTH - 1));
+  pRing->count--;
+
+  pEntry = &pRing->entries[pRing->head];
+  pGame->score = pEntry->score;
+  rngSetState(&pGame->rng, pEntry->rngState);
+  engineSetBoard(pGame, pEntry->board);
+  return TRUE;
+}
@@ -0,0 +1,54 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    undo.h
+ *
+ * Description:
+ *    Expose the undo ring of a game: the last UNDO_DEPTH states before a
+ *    move, each the packed board, the score and the generator state. The
+ *    ring is a fixed array, pushing over a full ring forgets the oldest
+ *    state.
+ *
+ *****************************************************************************/
+#ifndef _UNDO_H_
+#define _UNDO_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+/* Number of states kept, a power of two */
+#ifndef UNDO_DEPTH
+#define UNDO_DEPTH 16
+#endif
+
+typedef struct
+{
+  tBoard board;
+  tU32   rngState;
+  tU16   score;
+} tUndoEntry;
+
+typedef struct
+{
+  tUndoEntry entries[UNDO_DEPTH];
+  tU8        head;    /* slot of the next push */
+  tU8        count;   /* states that can be restored */
+} tUndoRing;
+
+#define undoAvailable(pRing) ((pRing)->count)
+
+
+void  undoClear(tUndoRing *pRing);
+void  undoPush(tUndoRing *pRing, const tGame *pGame);
+tBool undoPop(tUndoRing *pRing, tGame *pGame);
+
+#endif
@@ -0,0 +1,232 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    variant.c
+ *
+ * Description:
+ *    Implements the engine of the board size variants. The move kernels
+ *    are instantiated from variant_kernel.h for each size, everything that
+ *    runs once per move (spawn, summary, changed cells) is shared.
+ *
+ *****************************************************************************/
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "variant.h"
+
+#define VARIANT_N 3
+#include "variant_kernel.h"
+#undef VARIANT_N
+
+#define VARIANT_N 5
+#include "variant_kernel.h"
+#undef VARIANT_N
+
+#define VARIANT_N 6
+#include "variant_kernel.h"
+#undef VARIANT_N
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+typedef tBool (*tVariantMove)(tU32 *pRows, tU8 dir, tU8 *pMerges);
+
+
+/*****************************************************************************
+ * Local prototypes
+ ****************************************************************************/
+static void spawnTile(tVariantGame *pGame, tU32 rnd);
+static void updateSummary(tVariantGame *pGame);
+static tVariantMask changedCells(const tVariantGame *pGame, const tU32 *pBefore);
+
+
+/*****************************************************************************
+ * Local variables
+ ****************************************************************************/
+/* Move kernel of each size, NULL for sizes without one */
+static const tVariantMove variantMoves[VARIANT_MAX_SIZE + 1] =
+{
+  NULL, NULL, NULL, move3, NULL, move5, move6
+};
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Tells if the variant engine plays boards of the given size.
+ *
+ ****************************************************************************/
+
+tBool variantSupported(tU8 size)
+{
+  if (size > (tU8)VARIANT_MAX_SIZE) {
+    return FALSE;
+  }
+  return (variantMoves[size] != NULL) ? TRUE : FALSE;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Starts a new game of size x size cells with two tiles, see
+ *    engineNewGame().
+ *
+ ****************************************************************************/
+
+void variantNewGame(tVariantGame *pGame, tU8 size, tU32 seed)
+{
+  tU8 y;
+
+  rngSeed(&pGame->rng, seed);
+  pGame->size = size;
+  pGame->score = 0;
+  for (y = 0; y < (tU8)VARIANT_MAX_SIZE; ++y) {
+    pGame->row[y] = 0;
+  }
+  spawnTile(pGame, rngNext(&pGame->rng));
+  spawnTile(pGame, rngNext(&pGame->rng));
+  updateSummary(pGame);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Plays one move, see engineStep(). A move that changes nothing does
+ *    not spawn and does not advance the random number generator.
+ *
+ * Return: mask of the changed cells including the spawned one,
+ *         VARIANT_NO_MOVE if nothing moved
+ *
+ ****************************************************************************/
+
+tVariantMask variantStep(tVariantGame *pGame, tU8 dir)
+{
+  tU32 before[VARIANT_MAX_SIZE];
+  tU8 merges = 0;
+  tU8 y;
+
+  for (y = 0; y < pGame->size; ++y) {
+    before[y] = pGame->row[y];
+  }
+  if (variantMoves[pGame->size](pGame->row, dir, &merges) == FALSE) {
+    return VARIANT_NO_MOVE;
+  }
+  pGame->score += merges;
+  spawnTile(pGame, rngNext(&pGame->rng));
+  updateSummary(pGame);
+  return changedCells(pGame, before);
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Places a new tile in one of the empty cells, same use of the random
+ *    number as engineSpawn().
+ *
+ ****************************************************************************/
+
+static void spawnTile(tVariantGame *pGame, tU32 rnd)
+{
+  tU8 count = 0;
+  tU8 pick;
+  tU8 tile = 1;
+  tU8 y;
+  tU8 x;
+
+  for (y = 0; y < pGame->size; ++y) {
+    for (x = 0; x < pGame->size; ++x) {
+      if (variantGetCell(pGame, y, x) == (tU8)0) {
+        count++;
+      }
+    }
+  }
+  if (count == (tU8)0) {
+    return;
+  }
+
+  //scale instead of modulo, the ARM7 has no divide instruction
+  pick = (tU8)(((rnd & 0xffff) * count) >> 16);
+  if (((rnd >> 16) & 0x7fff) < (tU32)ENGINE_FOUR_CHANCE) {
+    tile = 2;
+  }
+  for (y = 0; y < pGame->size; ++y) {
+    for (x = 0; x < pGame->size; ++x) {
+      if (variantGetCell(pGame, y, x) != (tU8)0) {
+        continue;
+      }
+      if (pick == (tU8)0) {
+        pGame->row[y] |= (tU32)tile << (x * 4);
+        return;
+      }
+      pick--;
+    }
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Recomputes empty, maxTile and mergeable of the game.
+ *
+ ****************************************************************************/
+
+static void updateSummary(tVariantGame *pGame)
+{
+  tU8 tile;
+  tU8 y;
+  tU8 x;
+
+  pGame->empty = 0;
+  pGame->maxTile = 0;
+  pGame->mergeable = FALSE;
+  for (y = 0; y < pGame->size; ++y) {
+    for (x = 0; x < pGame->size; ++x) {
+      tile = variantGetCell(pGame, y, x);
+      if (tile == (tU8)0) {
+        pGame->empty++;
+        continue;
+      }
+      if (tile > pGame->maxTile) {
+        pGame->maxTile = tile;
+      }
+      //the largest tile does not merge, see slideRowN()
+      if (tile == (tU8)0x0f) {
+        continue;
+      }
+      if (((x + 1 < pGame->size) && (variantGetCell(pGame, y, x + 1) == tile)) ||
+          ((y + 1 < pGame->size) && (variantGetCell(pGame, y + 1, x) == tile))) {
+        pGame->mergeable = TRUE;
+      }
+    }
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Builds the mask of the cells that differ from the rows before a move.
+ *
+ ****************************************************************************/
+
+static tVariantMask changedCells(const tVariantGame *pGame, const tU32 *pBefore)
+{
+  tVariantMask changed = 0;
+  tU32 diff;
+  tU8 y;
+  tU8 x;
+
+  for (y = 0; y < pGame->size; ++y) {
+    diff = pGame->row[y] ^ pBefore[y];
+    for (x = 0; x < pGame->size; ++x) {
+      if (((diff >> (x * 4)) & 0x0f) != 0) {
+        changed |= (tVariantMask)1 << ((y * pGame->size) + x);
+      }
+    }
+  }
+  return changed;
+}
@@ -0,0 +1,70 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    variant.h
+ *
+ * Description:
+ *    Expose the engine of the board size variants (3x3, 5x5 and 6x6). The
+ *    4x4 game keeps the packed engine of engine.h, these sizes do not fit
+ *    its 64-bit board. A variant board is one word per row holding size
+ *    tile exponents, cell (y, x) in nibble x of row y, so a row takes 12,
+ *    20 or 24 bits. Every size gets its own slide kernel, see
+ *    variant_kernel.h. Directions are those of engine.h.
+ *
+ *****************************************************************************/
+#ifndef _VARIANT_H_
+#define _VARIANT_H_
+
+/******************************************************************************
+ * Includes
+ *****************************************************************************/
+#include "engine.h"
+
+
+/******************************************************************************
+ * Typedefs and defines
+ *****************************************************************************/
+#define VARIANT_MIN_SIZE 3
+#define VARIANT_MAX_SIZE 6
+
+/*
+ * Cell masks hold one bit per cell, bit y*size+x for cell (y, x).
+ * A move returning VARIANT_NO_MOVE changed nothing and did not spawn.
+ */
+typedef unsigned long long tVariantMask;
+
+#define VARIANT_NO_MOVE 0
+
+/*
+ * A game on a board of size x size cells, see tGame. empty, maxTile and
+ * mergeable are kept up to date by every move.
+ */
+typedef struct
+{
+  tU32  row[VARIANT_MAX_SIZE];
+  tU16  score;      /* number of merges */
+  tRng  rng;
+  tU8   size;
+  tU8   empty;      /* number of empty cells */
+  tU8   maxTile;    /* exponent of the largest tile */
+  tBool mergeable;  /* two equal tiles are neighbours */
+} tVariantGame;
+
+#define variantGameOver(pGame) \
+  (((pGame)->empty == 0) && ((pGame)->mergeable == FALSE))
+
+#define variantGameWon(pGame) \
+  ((pGame)->maxTile >= ENGINE_WIN_TILE)
+
+#define variantGetCell(pGame, y, x) \
+  ((tU8)(((pGame)->row[(y)] >> ((x) * 4)) & 0x0f))
+
+
+tBool        variantSupported(tU8 size);
+void         variantNewGame(tVariantGame *pGame, tU8 size, tU32 seed);
+tVariantMask variantStep(tVariantGame *pGame, tU8 dir);
+
+#endif
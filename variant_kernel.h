@@ -0,0 +1,177 @@
+/******************************************************************************
+ *
+ * A03
+ * 2020/21
+ *
+ * File:
+ *    variant_kernel.h
+ *
+ * Description:
+ *    Move kernel of one board size of the variant engine. Included by
+ *    variant.c once per size with VARIANT_N defined; every function gets
+ *    the size appended to its name (slideRow5, move5, ...). The loops run
+ *    to the constant VARIANT_N, so the compiler unrolls each size on its
+ *    own and no kernel pays for the generality of another.
+ *
+ *****************************************************************************/
+#if !defined(VARIANT_N)
+#error "define VARIANT_N before including variant_kernel.h"
+#endif
+
+#define VARIANT_PASTE2(name, n) name##n
+#define VARIANT_PASTE(name, n)  VARIANT_PASTE2(name, n)
+#define VARIANT_FN(name)        VARIANT_PASTE(name, VARIANT_N)
+
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Slides one row of VARIANT_N cells towards nibble 0, same rules as
+ *    engineSlideRow().
+ *
+ ****************************************************************************/
+
+static tU32 VARIANT_FN(slideRow)(tU32 row, tU8 *pMerges)
+{
+  tU32 result = 0;
+  tU8 shift = 0;
+  tU8 pending = 0;
+  tU8 tile;
+  tU8 k;
+
+  for (k = 0; k < (tU8)VARIANT_N; ++k) {
+    tile = (tU8)((row >> (k * 4)) & 0x0f);
+    if (tile == (tU8)0) {
+      continue;
+    }
+
+    if ((tile == pending) && (tile < (tU8)0x0f)) {
+      result |= (tU32)(tile + 1) << shift;
+      shift += 4;
+      pending = 0;
+      (*pMerges)++;
+    } else {
+      if (pending != (tU8)0) {
+        result |= (tU32)pending << shift;
+        shift += 4;
+      }
+      pending = tile;
+    }
+  }
+
+  if (pending != (tU8)0) {
+    result |= (tU32)pending << shift;
+  }
+  return result;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reverses the order of the VARIANT_N nibbles of a row.
+ *
+ ****************************************************************************/
+
+static tU32 VARIANT_FN(reverseRow)(tU32 row)
+{
+  tU32 result = 0;
+  tU8 k;
+
+  for (k = 0; k < (tU8)VARIANT_N; ++k) {
+    result |= ((row >> (k * 4)) & 0x0f) << ((VARIANT_N - 1 - k) * 4);
+  }
+  return result;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Reads column x as a row, cell (0, x) in nibble 0.
+ *
+ ****************************************************************************/
+
+static tU32 VARIANT_FN(getColumn)(const tU32 *pRows, tU8 x)
+{
+  tU32 column = 0;
+  tU8 y;
+
+  for (y = 0; y < (tU8)VARIANT_N; ++y) {
+    column |= ((pRows[y] >> (x * 4)) & 0x0f) << (y * 4);
+  }
+  return column;
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Writes a row read by getColumn() back to column x.
+ *
+ ****************************************************************************/
+
+static void VARIANT_FN(setColumn)(tU32 *pRows, tU8 x, tU32 column)
+{
+  tU8 y;
+
+  for (y = 0; y < (tU8)VARIANT_N; ++y) {
+    pRows[y] = (pRows[y] & ~((tU32)0x0f << (x * 4))) |
+               (((column >> (y * 4)) & 0x0f) << (x * 4));
+  }
+}
+
+/*****************************************************************************
+ *
+ * Description:
+ *    Moves all tiles of the board in the given direction.
+ *
+ * Params:
+ *    [in/out] pRows   - The VARIANT_N rows of the board.
+ *    [in]     dir     - ENGINE_UP, ENGINE_RIGHT, ENGINE_DOWN or ENGINE_LEFT.
+ *    [out]    pMerges - Incremented once per merge.
+ *
+ * Return: TRUE if any tile moved
+ *
+ ****************************************************************************/
+
+static tBool VARIANT_FN(move)(tU32 *pRows, tU8 dir, tU8 *pMerges)
+{
+  tU32 line;
+  tU32 slid;
+  tBool moved = FALSE;
+  tU8 i;
+
+  for (i = 0; i < (tU8)VARIANT_N; ++i) {
+    switch (dir) {
+      case ENGINE_LEFT:
+        line = pRows[i];
+        slid = VARIANT_FN(slideRow)(line, pMerges);
+        pRows[i] = slid;
+        break;
+
+      case ENGINE_RIGHT:
+        line = VARIANT_FN(reverseRow)(pRows[i]);
+        slid = VARIANT_FN(slideRow)(line, pMerges);
+        pRows[i] = VARIANT_FN(reverseRow)(slid);
+        break;
+
+      case ENGINE_UP:
+        line = VARIANT_FN(getColumn)(pRows, i);
+        slid = VARIANT_FN(slideRow)(line, pMerges);
+        VARIANT_FN(setColumn)(pRows, i, slid);
+        break;
+
+      default:
+        line = VARIANT_FN(reverseRow)(VARIANT_FN(getColumn)(pRows, i));
+        slid = VARIANT_FN(slideRow)(line, pMerges);
+        VARIANT_FN(setColumn)(pRows, i, VARIANT_FN(reverseRow)(slid));
+        break;
+    }
+    if (slid != line) {
+      moved = TRUE;
+    }
+  }
+  return moved;
+}
+
+#undef VARIANT_FN
+#undef VARIANT_PASTE
+#undef VARIANT_PASTE2